@@ -22,11 +22,9 @@ MainWindow::~MainWindow()
 
 void MainWindow::SetupLayout()
 {
-    // 设置时间轴
-    QStringList timeline;
-    timeline << "00:00" << "01:00" << "02:00" << "03:00" << "04:00" << "05:00" << "06:00" << "07:00" << "08:00" << "09:00" << "10:00";
-    timeline << "11:00" << "12:00" << "13:00" << "14:00" << "15:00" << "16:00" << "17:00" << "18:00" << "19:00" << "20:00";
-    m_rangeTable.SetHeader(timeline, 100); // 每列宽100
+    // 设置时间轴，刻度和标签随缩放自动生成
+    const int minutes = 21;
+    m_rangeTable.SetHeader(minutes, 100); // 每列宽100
 
     // 设置视频名
     QStringList videos;
@@ -34,11 +32,11 @@ void MainWindow::SetupLayout()
     m_rangeTable.SetRows(videos, 100); // 每行高100
 
     // 创建布局并映射到时间范围
-    m_rangeTable.SetupLayout(timeline.size()*60); // 每列1min
+    m_rangeTable.SetupLayout(minutes*60); // 每列1min
 
-    // 添加表格数据
-    m_rangeTable.AddCellData(0, 0, QImage(":/demo/1x1.png"));
-    m_rangeTable.AddCellData(1, 1, QImage(":/demo/2x2.png"));
+    // 添加表格数据，图片在后台解码
+    m_rangeTable.AddCellData(0, 0, QString(":/demo/1x1.png"));
+    m_rangeTable.AddCellData(1, 1, QString(":/demo/2x2.png"));
 
     setCentralWidget(&m_rangeTable);
 }
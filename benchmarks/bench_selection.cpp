@@ -0,0 +1,379 @@
+#include <QApplication>
+#include <QMouseEvent>
+#include <QImage>
+#include <QtTest>
+#include <random>
+#include "rangetable.h"
+#include "selectionindex.h"
+
+// 合成负载：行数和片段数，片段随机分布在整个时间轴上
+static const int ColumnCount = 20;          // 每列1分钟
+static const int ColumnWidth = 100;
+static const int RowHeight = 40;
+static const qint64 TicksPerSecond = 1000;
+static const qint64 SpanTicks = ColumnCount * 60 * TicksPerSecond;
+
+struct EditOp
+{
+    int row;
+    qint64 start;
+    qint64 end;
+    bool add;
+};
+
+static const struct
+{
+    const char* name;
+    int rows;
+    int segments;
+} Workloads[] = {
+    { "1x10", 1, 10 },
+    { "10x1000", 10, 1000 },
+    { "100x10000", 100, 10000 },
+    { "1000x100000", 1000, 100000 },
+};
+
+static void AddWorkloads()
+{
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<int>("segments");
+
+    for (size_t i = 0; i < sizeof(Workloads) / sizeof(Workloads[0]); ++i)
+    {
+        QTest::newRow(Workloads[i].name) << Workloads[i].rows << Workloads[i].segments;
+    }
+}
+
+static QVector<RowTickRange> RandomSegments(int rows, int segments, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> rowDist(0, rows - 1);
+    std::uniform_int_distribution<qint64> startDist(0, SpanTicks - 1);
+    std::uniform_int_distribution<qint64> lengthDist(1, qMax<qint64>(1, SpanTicks / segments * 2));
+
+    QVector<RowTickRange> ranges;
+    ranges.reserve(segments);
+    for (int i = 0; i < segments; ++i)
+    {
+        qint64 start = startDist(gen);
+        ranges.push_back(RowTickRange(rowDist(gen), start, qMin(SpanTicks - 1, start + lengthDist(gen))));
+    }
+    return ranges;
+}
+
+// 增删交替的随机编辑序列，删除约占三分之一
+static QVector<EditOp> RandomEdits(int rows, int count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> rowDist(0, rows - 1);
+    std::uniform_int_distribution<qint64> startDist(0, SpanTicks - 1);
+    std::uniform_int_distribution<qint64> lengthDist(1, SpanTicks / 100);
+    std::uniform_int_distribution<int> kindDist(0, 2);
+
+    QVector<EditOp> ops;
+    ops.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        EditOp op;
+        op.row = rowDist(gen);
+        op.start = startDist(gen);
+        op.end = qMin(SpanTicks - 1, op.start + lengthDist(gen));
+        op.add = kindDist(gen) != 0;
+        ops.push_back(op);
+    }
+    return ops;
+}
+
+// 窗口没有显示出来时返回false，调用处用QVERIFY终止当前测试
+static bool SetupTable(RangeTable& table, int rows)
+{
+    QStringList header;
+    for (int i = 0; i < ColumnCount; ++i)
+    {
+        header << QString("%1:00").arg(i, 2, 10, QChar('0'));
+    }
+    QStringList rowTexts;
+    for (int i = 0; i < rows; ++i)
+    {
+        rowTexts << QString("camera %1").arg(i + 1);
+    }
+
+    table.SetHeader(header, ColumnWidth);
+    table.SetRows(rowTexts, RowHeight);
+    table.SetTimeBase(TicksPerSecond);
+    table.SetupLayout(ColumnCount * 60);
+    table.resize(1280, 720);
+    table.show();
+    return QTest::qWaitForWindowExposed(&table);
+}
+
+// 直接向视口发送鼠标事件，完整走一遍拖动选择和ProcessNewSelection
+static void DragSelect(RangeTable& table, int row, int startX, int endX)
+{
+    QWidget* viewport = table.viewport();
+    QPoint from(startX, table.rowViewportPosition(row) + RowHeight / 2);
+    QPoint to(endX, from.y());
+
+    QMouseEvent press(QEvent::MouseButtonPress, from, Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    QApplication::sendEvent(viewport, &press);
+    QMouseEvent move(QEvent::MouseMove, to, Qt::NoButton, Qt::LeftButton, Qt::NoModifier);
+    QApplication::sendEvent(viewport, &move);
+    QMouseEvent release(QEvent::MouseButtonRelease, to, Qt::LeftButton, Qt::NoButton, Qt::NoModifier);
+    QApplication::sendEvent(viewport, &release);
+}
+
+class SelectionBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 单次增删的索引开销
+    void IndexEdit_data() { AddWorkloads(); }
+    void IndexEdit()
+    {
+        QFETCH(int, rows);
+        QFETCH(int, segments);
+
+        SelectionIndex index;
+        index.Reset(rows);
+        QVector<RowSpan> spans;
+        QVector<RowTickRange> ranges = RandomSegments(rows, segments, 1);
+        for (int i = 0; i < ranges.size(); ++i)
+        {
+            spans.push_back(RowSpan(ranges[i].row, ranges[i].begin, ranges[i].end));
+        }
+        index.Merge(spans, SelectionIndex::Conflict_KeepExisting);
+
+        QVector<EditOp> ops = RandomEdits(rows, 4096, 2);
+        int next = 0;
+        QBENCHMARK
+        {
+            const EditOp& op = ops[next++ % ops.size()];
+            if (op.add)
+            {
+                index.Add(op.row, op.start, op.end);
+            }
+            else
+            {
+                index.Subtract(op.row, op.start, op.end);
+            }
+        }
+    }
+
+    // 一次鼠标拖动选择：事件处理、索引更新、撤销记录和局部重绘
+    void MouseSelect_data() { AddWorkloads(); }
+    void MouseSelect()
+    {
+        QFETCH(int, rows);
+        QFETCH(int, segments);
+
+        RangeTable table(nullptr);
+        QVERIFY(SetupTable(table, rows));
+        table.ApplySelections(RandomSegments(rows, segments, 1), SelectionIndex::Conflict_KeepExisting);
+
+        std::mt19937 gen(3);
+        int visibleRows = qMin(rows, table.viewport()->height() / RowHeight);
+        std::uniform_int_distribution<int> rowDist(0, qMax(0, visibleRows - 1));
+        std::uniform_int_distribution<int> xDist(0, table.viewport()->width() - 1);
+        std::uniform_int_distribution<int> kindDist(0, 2);
+        QBENCHMARK
+        {
+            table.SetSelectionMode(kindDist(gen) != 0);
+            DragSelect(table, rowDist(gen), xDist(gen), xDist(gen));
+        }
+    }
+
+    // 批量导入全部片段
+    void ApplySelections_data() { AddWorkloads(); }
+    void ApplySelections()
+    {
+        QFETCH(int, rows);
+        QFETCH(int, segments);
+
+        RangeTable table(nullptr);
+        QVERIFY(SetupTable(table, rows));
+        QVector<RowTickRange> ranges = RandomSegments(rows, segments, 1);
+        QBENCHMARK
+        {
+            table.ResetSelection();
+            table.ApplySelections(ranges, SelectionIndex::Conflict_KeepExisting);
+        }
+    }
+
+    // 整个视口绘制一帧的时间，包括代理绘制的单元格缩略图
+    void PaintFrame_data()
+    {
+        QTest::addColumn<int>("rows");
+        QTest::addColumn<int>("segments");
+        QTest::addColumn<int>("mode");
+
+        for (size_t i = 0; i < sizeof(Workloads) / sizeof(Workloads[0]); ++i)
+        {
+            QTest::newRow(QByteArray(Workloads[i].name).append("/per-cell").constData())
+                    << Workloads[i].rows << Workloads[i].segments << static_cast<int>(RangeTable::Render_PerCell);
+            QTest::newRow(QByteArray(Workloads[i].name).append("/row-strip").constData())
+                    << Workloads[i].rows << Workloads[i].segments << static_cast<int>(RangeTable::Render_RowStrip);
+        }
+    }
+    void PaintFrame()
+    {
+        QFETCH(int, rows);
+        QFETCH(int, segments);
+        QFETCH(int, mode);
+
+        RangeTable table(nullptr);
+        QVERIFY(SetupTable(table, rows));
+        table.SetRenderMode(static_cast<RangeTable::RenderMode>(mode));
+        table.ApplySelections(RandomSegments(rows, segments, 1), SelectionIndex::Conflict_KeepExisting);
+
+        QImage thumbnail(ColumnWidth, RowHeight, QImage::Format_RGB32);
+        thumbnail.fill(Qt::darkGray);
+        for (int row = 0; row < qMin(rows, 32); ++row)
+        {
+            for (int col = 0; col < ColumnCount; ++col)
+            {
+                table.AddCellData(row, col, thumbnail);
+            }
+        }
+
+        QImage frame(table.size(), QImage::Format_ARGB32_Premultiplied);
+        table.render(&frame);   // 预热缩略图缓存
+        QBENCHMARK
+        {
+            table.render(&frame);
+        }
+    }
+
+    // 1万行、1440列（24小时每列1分钟）的重新布局
+    void SetupLayout()
+    {
+        const int rows = 10000;
+        const int columns = 1440;
+        QStringList header;
+        for (int i = 0; i < columns; ++i)
+        {
+            header << QString("%1:%2").arg(i / 60, 2, 10, QChar('0')).arg(i % 60, 2, 10, QChar('0'));
+        }
+        QStringList rowTexts;
+        for (int i = 0; i < rows; ++i)
+        {
+            rowTexts << QString("camera %1").arg(i + 1);
+        }
+
+        RangeTable table(nullptr);
+        table.resize(1280, 720);
+        table.show();
+        QVERIFY(QTest::qWaitForWindowExposed(&table));
+        QBENCHMARK
+        {
+            table.SetHeader(header, ColumnWidth);
+            table.SetRows(rowTexts, RowHeight);
+            table.SetupLayout(columns * 60);
+        }
+    }
+
+    // 跟随播放头的一帧：平移视口，只重绘露出的一条和播放头
+    void FollowPlayhead()
+    {
+        RangeTable table(nullptr);
+        QVERIFY(SetupTable(table, 100));
+        table.ApplySelections(RandomSegments(100, 10000, 1), SelectionIndex::Conflict_KeepExisting);
+        table.SetFollowPlayhead(true);
+        QApplication::processEvents();
+
+        qint64 tick = 0;
+        QBENCHMARK
+        {
+            tick = (tick + TicksPerSecond / 30) % SpanTicks;
+            table.SetPlayheadTick(tick);
+            QApplication::processEvents();
+        }
+    }
+
+    void ExportTimes_data() { AddWorkloads(); }
+    void ExportTimes()
+    {
+        QFETCH(int, rows);
+        QFETCH(int, segments);
+
+        RangeTable table(nullptr);
+        QVERIFY(SetupTable(table, rows));
+        table.ApplySelections(RandomSegments(rows, segments, 1), SelectionIndex::Conflict_KeepExisting);
+        QBENCHMARK
+        {
+            QVector<QVector<TimeRange> > times = table.GetSelectionTimes();
+            Q_UNUSED(times);
+        }
+    }
+
+    // 快照不带缓存，每次都重新合并排序，测的是导出本身的代价
+    void ExportRowTimes_data() { AddWorkloads(); }
+    void ExportRowTimes()
+    {
+        QFETCH(int, rows);
+        QFETCH(int, segments);
+
+        RangeTable table(nullptr);
+        QVERIFY(SetupTable(table, rows));
+        table.ApplySelections(RandomSegments(rows, segments, 1), SelectionIndex::Conflict_KeepExisting);
+        QBENCHMARK
+        {
+            QVector<RowTimeRange> times = table.Snapshot().GetRowTimes();
+            Q_UNUSED(times);
+        }
+    }
+
+    // 选择未变时重复导出，命中缓存只复制一次隐式共享的引用
+    void ExportRowTimesCached_data() { AddWorkloads(); }
+    void ExportRowTimesCached()
+    {
+        QFETCH(int, rows);
+        QFETCH(int, segments);
+
+        RangeTable table(nullptr);
+        QVERIFY(SetupTable(table, rows));
+        table.ApplySelections(RandomSegments(rows, segments, 1), SelectionIndex::Conflict_KeepExisting);
+        table.GetRowTimes();
+        QBENCHMARK
+        {
+            QVector<RowTimeRange> times = table.GetRowTimes();
+            Q_UNUSED(times);
+        }
+    }
+
+    // 导出线程持有快照时的编辑代价：每次编辑前都有一个新快照，写入时要分离被修改的块
+    void EditWithSnapshot_data() { AddWorkloads(); }
+    void EditWithSnapshot()
+    {
+        QFETCH(int, rows);
+        QFETCH(int, segments);
+
+        RangeTable table(nullptr);
+        QVERIFY(SetupTable(table, rows));
+        table.ApplySelections(RandomSegments(rows, segments, 1), SelectionIndex::Conflict_KeepExisting);
+        qint64 tick = 0;
+        QBENCHMARK
+        {
+            SelectionSnapshot snapshot = table.Snapshot();
+            tick = (tick + 997) % SpanTicks;
+            QVector<RowTickRange> ranges;
+            ranges.push_back(RowTickRange(0, tick, tick + 10));
+            table.ApplySelections(ranges, SelectionIndex::Conflict_Overwrite);
+            Q_UNUSED(snapshot);
+        }
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    // 没有显示设备也能运行，绘制结果只输出到QImage
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    SelectionBenchmark benchmark;
+    return QTest::qExec(&benchmark, argc, argv);
+}
+
+#include "bench_selection.moc"
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# 选择引擎、绘制和导出的性能基准
+# 运行：./vmerge_bench [-iterations n] [函数名[:数据行]]
+#
+#-------------------------------------------------
+
+QT       += core gui testlib
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = vmerge_bench
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../widget/widget.pri)
+
+SOURCES += \
+        bench_selection.cpp
@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# 命令行工具：执行选择脚本，输出合并计划
+# 用法：vmerge_plan [-t] [script]
+#
+#-------------------------------------------------
+
+QT       = core
+
+TARGET = vmerge_plan
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../engine/engine.pri)
+
+SOURCES += \
+        main.cpp
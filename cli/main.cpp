@@ -0,0 +1,270 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+#include "selectionengine.h"
+
+// 选择脚本，每行一条命令，#之后为注释
+// 时间可以是刻度整数，也可以是h:mm:ss[.zzz]（小时数不受24小时限制）
+//   timebase <每秒刻度数>
+//   rows <行数>                 清空选择并设置行数，行标签为row 1、row 2……
+//   policy keep|overwrite|lower
+//   add <行> <起点> <终点>       连续的add合并为一次批量导入
+//   sub <行> <起点> <终点>
+//   undo | redo
+//   load <工程文件> [日志文件]   日志只读重放
+//   save <工程文件>
+class PlanScript
+{
+public:
+    PlanScript()
+        : m_policy(SelectionIndex::Conflict_KeepExisting)
+        , m_timeSpanTicks(0)
+    {
+
+    }
+
+    bool Run(QTextStream& input, QTextStream& errors)
+    {
+        int lineNumber = 0;
+        while (!input.atEnd())
+        {
+            ++lineNumber;
+            QString line = input.readLine();
+            int comment = line.indexOf('#');
+            if (comment >= 0)
+            {
+                line.truncate(comment);
+            }
+            QStringList args = line.split(' ', Qt::SkipEmptyParts);
+            if (args.isEmpty())
+            {
+                continue;
+            }
+            QString error = Execute(args);
+            if (!error.isEmpty())
+            {
+                errors << "line " << lineNumber << ": " << error << '\n';
+                errors.flush();
+                return false;
+            }
+        }
+        Flush();
+        return true;
+    }
+
+    // 合并计划：按时间顺序列出每段取自哪一行
+    void WritePlan(QTextStream& output, bool asTime) const
+    {
+        m_engine.ForEachRowTick([this, &output, asTime](const RowTickRange& range) {
+            output << range.row << '\t';
+            if (asTime)
+            {
+                output << FormatTick(range.begin) << '\t' << FormatTick(range.end) << '\n';
+            }
+            else
+            {
+                output << range.begin << '\t' << range.end << '\n';
+            }
+            return true;
+        });
+        output.flush();
+    }
+
+private:
+    QString Execute(const QStringList& args)
+    {
+        const QString& command = args[0];
+        if (command != "add")
+        {
+            Flush();
+        }
+
+        if (command == "add" || command == "sub")
+        {
+            qint64 start = 0, end = 0;
+            bool ok = false;
+            int row = args.size() == 4 ? args[1].toInt(&ok) : -1;
+            if (!ok || row < 0 || row >= m_engine.Selections().RowCount())
+            {
+                return "bad row";
+            }
+            if (!ParseTick(args[2], start) || !ParseTick(args[3], end))
+            {
+                return "bad time";
+            }
+            m_timeSpanTicks = qMax(m_timeSpanTicks, qMax(start, end) + 1);
+            if (command == "add")
+            {
+                m_pending.push_back(RowTickRange(row, start, end));
+            }
+            else
+            {
+                m_engine.Subtract(row, start, end);
+            }
+        }
+        else if (command == "timebase" && args.size() == 2 && args[1].toInt() > 0)
+        {
+            m_engine.SetTimeBase(args[1].toInt());
+        }
+        else if (command == "rows" && args.size() == 2 && args[1].toInt() >= 0)
+        {
+            // 工程文件按行标签数布局，保存前必须有每行的标签
+            int rowCount = args[1].toInt();
+            m_engine.Reset(rowCount);
+            m_rowLabels.clear();
+            for (int i = 0; i < rowCount; ++i)
+            {
+                m_rowLabels << QString("row %1").arg(i + 1);
+            }
+        }
+        else if (command == "policy" && args.size() == 2)
+        {
+            if (args[1] == "keep")
+                m_policy = SelectionIndex::Conflict_KeepExisting;
+            else if (args[1] == "overwrite")
+                m_policy = SelectionIndex::Conflict_Overwrite;
+            else if (args[1] == "lower")
+                m_policy = SelectionIndex::Conflict_LowerRow;
+            else
+                return "unknown policy " + args[1];
+        }
+        else if (command == "undo" && args.size() == 1)
+        {
+            m_engine.Undo();
+        }
+        else if (command == "redo" && args.size() == 1)
+        {
+            m_engine.Redo();
+        }
+        else if (command == "load" && (args.size() == 2 || args.size() == 3))
+        {
+            ProjectFile file;
+            if (!file.Open(args[1]) || !m_engine.Load(file))
+            {
+                return "cannot load " + args[1];
+            }
+            // 批处理只读取日志，之后的脚本编辑不能追加到用户的日志里
+            if (args.size() == 3 && m_engine.ReplayJournal(args[2]) < 0)
+            {
+                return "cannot replay " + args[2];
+            }
+            m_rowLabels = file.RowLabels();
+            m_columnLabels = file.ColumnLabels();
+            m_timeSpanTicks = file.TimeSpanTicks();
+        }
+        else if (command == "save" && args.size() == 2)
+        {
+            if (!m_engine.Save(args[1], m_timeSpanTicks, m_rowLabels, m_columnLabels))
+            {
+                return "cannot save " + args[1];
+            }
+        }
+        else
+        {
+            return "bad command: " + args.join(' ');
+        }
+        return QString();
+    }
+
+    void Flush()
+    {
+        if (!m_pending.isEmpty())
+        {
+            m_engine.ApplySelections(m_pending, m_policy);
+            m_pending.clear();
+        }
+    }
+
+    bool ParseTick(const QString& text, qint64& tick) const
+    {
+        bool ok = false;
+        if (!text.contains(':'))
+        {
+            tick = text.toLongLong(&ok);
+            return ok;
+        }
+        QStringList parts = text.split(':');
+        if (parts.size() > 3)
+        {
+            return false;
+        }
+        qint64 minutes = 0;
+        for (int i = 0; i + 1 < parts.size(); ++i)
+        {
+            minutes = minutes * 60 + parts[i].toLongLong(&ok);
+            if (!ok)
+            {
+                return false;
+            }
+        }
+        double seconds = parts.back().toDouble(&ok);
+        if (!ok)
+        {
+            return false;
+        }
+        qint64 msecs = minutes * 60000 + qRound64(seconds * 1000);
+        tick = msecs * m_engine.TicksPerSecond() / 1000;
+        return true;
+    }
+
+    QString FormatTick(qint64 tick) const
+    {
+        qint64 msecs = tick * 1000 / m_engine.TicksPerSecond();
+        return QString("%1:%2:%3.%4")
+                .arg(msecs / 3600000)
+                .arg(msecs / 60000 % 60, 2, 10, QChar('0'))
+                .arg(msecs / 1000 % 60, 2, 10, QChar('0'))
+                .arg(msecs % 1000, 3, 10, QChar('0'));
+    }
+
+private:
+    SelectionEngine m_engine;
+    SelectionIndex::ConflictPolicy m_policy;
+    QVector<RowTickRange> m_pending;
+    QStringList m_rowLabels;
+    QStringList m_columnLabels;
+    qint64 m_timeSpanTicks;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("vmerge_plan");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Apply a selection script and print the merge plan: row, begin, end.");
+    parser.addHelpOption();
+    QCommandLineOption timeOption(QStringList() << "t" << "time", "Print h:mm:ss.zzz instead of ticks.");
+    parser.addOption(timeOption);
+    parser.addPositionalArgument("script", "Selection script, reads stdin if omitted.");
+    parser.process(app);
+
+    QTextStream errors(stderr);
+    QFile scriptFile;
+    QStringList positional = parser.positionalArguments();
+    if (positional.isEmpty())
+    {
+        scriptFile.open(stdin, QIODevice::ReadOnly);
+    }
+    else
+    {
+        scriptFile.setFileName(positional[0]);
+        if (!scriptFile.open(QIODevice::ReadOnly))
+        {
+            errors << "cannot open " << positional[0] << '\n';
+            errors.flush();
+            return 1;
+        }
+    }
+
+    QTextStream input(&scriptFile);
+    PlanScript script;
+    if (!script.Run(input, errors))
+    {
+        return 1;
+    }
+    QTextStream output(stdout);
+    script.WritePlan(output, parser.isSet(timeOption));
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "activitypyramid.h"
+
+#include <algorithm>
+#include <limits>
+
+// 相邻两个值取最小/最大，连续数组上的简单循环，编译器可以自动向量化
+static void ReduceMin(const float* in, int count, float* out)
+{
+    int pairs = count / 2;
+    for (int i = 0; i < pairs; ++i)
+    {
+        out[i] = std::min(in[2*i], in[2*i + 1]);
+    }
+    if (count % 2)
+    {
+        out[pairs] = in[count - 1];
+    }
+}
+
+static void ReduceMax(const float* in, int count, float* out)
+{
+    int pairs = count / 2;
+    for (int i = 0; i < pairs; ++i)
+    {
+        out[i] = std::max(in[2*i], in[2*i + 1]);
+    }
+    if (count % 2)
+    {
+        out[pairs] = in[count - 1];
+    }
+}
+
+ActivityPyramid::ActivityPyramid()
+    : m_startTick(0)
+    , m_ticksPerSample(1)
+{
+
+}
+
+// 第0层的最小和最大值就是原始采样，两边共享同一份数据
+void ActivityPyramid::Build(const QVector<float>& samples, qint64 startTick, qint64 ticksPerSample)
+{
+    m_min.clear();
+    m_max.clear();
+    m_startTick = startTick;
+    m_ticksPerSample = qMax(Q_INT64_C(1), ticksPerSample);
+    if (samples.isEmpty())
+    {
+        return;
+    }
+
+    m_min.push_back(samples);
+    m_max.push_back(samples);
+    while (m_min.back().size() > 1)
+    {
+        const QVector<float>& lowerMin = m_min.back();
+        const QVector<float>& lowerMax = m_max.back();
+        int count = lowerMin.size();
+        QVector<float> upperMin((count + 1) / 2);
+        QVector<float> upperMax((count + 1) / 2);
+        ReduceMin(lowerMin.constData(), count, upperMin.data());
+        ReduceMax(lowerMax.constData(), count, upperMax.data());
+        m_min.push_back(upperMin);
+        m_max.push_back(upperMax);
+    }
+}
+
+bool ActivityPyramid::IsEmpty() const
+{
+    return m_min.isEmpty();
+}
+
+qint64 ActivityPyramid::StartTick() const
+{
+    return m_startTick;
+}
+
+qint64 ActivityPyramid::EndTick() const
+{
+    return IsEmpty() ? m_startTick - 1 : m_startTick + m_min[0].size() * m_ticksPerSample - 1;
+}
+
+float ActivityPyramid::MinValue() const
+{
+    return IsEmpty() ? 0 : m_min.back()[0];
+}
+
+float ActivityPyramid::MaxValue() const
+{
+    return IsEmpty() ? 0 : m_max.back()[0];
+}
+
+void ActivityPyramid::Sample(const TimeScale& scale, int firstPixel, int lastPixel,
+                             QVector<float>& minValues, QVector<float>& maxValues) const
+{
+    int pixels = qMax(0, lastPixel - firstPixel + 1);
+    minValues.fill(std::numeric_limits<float>::max(), pixels);
+    maxValues.fill(-std::numeric_limits<float>::max(), pixels);
+    if (IsEmpty() || !scale.IsValid())
+    {
+        return;
+    }
+
+    qint64 sampleCount = m_min[0].size();
+    qint64 pixelStart = scale.ToTick(firstPixel);
+    for (int i = 0; i < pixels; ++i)
+    {
+        qint64 pixelEnd = scale.ToTick(firstPixel + i + 1) - 1;
+        qint64 first = qMax(Q_INT64_C(0), (pixelStart - m_startTick) / m_ticksPerSample);
+        qint64 last = pixelEnd < m_startTick ? -1 : qMin(sampleCount - 1, (pixelEnd - m_startTick) / m_ticksPerSample);
+        pixelStart = pixelEnd + 1;
+        if (first > last)
+        {
+            continue;
+        }
+
+        // 块大小不超过像素内采样数，像素最多跨三个块
+        int level = 0;
+        while (level + 1 < m_min.size() && (Q_INT64_C(2) << level) <= last - first + 1)
+        {
+            ++level;
+        }
+        const QVector<float>& mins = m_min[level];
+        const QVector<float>& maxs = m_max[level];
+        float low = mins[static_cast<int>(first >> level)];
+        float high = maxs[static_cast<int>(first >> level)];
+        for (int block = static_cast<int>(first >> level) + 1; block <= static_cast<int>(last >> level); ++block)
+        {
+            low = std::min(low, mins[block]);
+            high = std::max(high, maxs[block]);
+        }
+        minValues[i] = low;
+        maxValues[i] = high;
+    }
+}
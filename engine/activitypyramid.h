@@ -0,0 +1,39 @@
+#ifndef ACTIVITYPYRAMID_H
+#define ACTIVITYPYRAMID_H
+
+#include <QMetaType>
+#include <QVector>
+#include "rangetypes.h"
+
+// 单行活动量序列（运动量、音量等）的最小/最大值金字塔
+// 第0层是原始采样，往上每层两两合并。任意缩放下每个像素从采样数不超过像素宽度的最粗一层取值，
+// 每个像素只合并两到三个值，绘制代价只和像素数有关，与序列长度无关
+class ActivityPyramid
+{
+public:
+    ActivityPyramid();
+
+    // 第i个采样覆盖刻度[startTick + i*ticksPerSample, startTick + (i+1)*ticksPerSample - 1]
+    void Build(const QVector<float>& samples, qint64 startTick, qint64 ticksPerSample);
+    bool IsEmpty() const;
+    qint64 StartTick() const;
+    qint64 EndTick() const;
+    // 整个序列的取值范围，用于纵向归一化
+    float MinValue() const;
+    float MaxValue() const;
+
+    // 取像素[firstPixel, lastPixel]内的最小/最大值，像素相对于时间轴起点；没有采样的像素min大于max
+    // 粗层的块可能跨过像素边缘，边缘像素会带上相邻不到一个像素的采样
+    void Sample(const TimeScale& scale, int firstPixel, int lastPixel,
+                QVector<float>& minValues, QVector<float>& maxValues) const;
+
+private:
+    QVector<QVector<float> > m_min;
+    QVector<QVector<float> > m_max;
+    qint64 m_startTick;
+    qint64 m_ticksPerSample;
+};
+
+Q_DECLARE_METATYPE(ActivityPyramid)
+
+#endif // ACTIVITYPYRAMID_H
@@ -0,0 +1,239 @@
+#ifndef CHUNKEDMAP_H
+#define CHUNKEDMAP_H
+
+#include <QVector>
+#include <algorithm>
+
+// 分块保存的有序映射，提供SelectionIndex用到的QMap接口子集
+// 键值对按键排序，切成若干个不超过MaxChunk项的有序数组块；块数组和每个块都是隐式共享的QVector。
+// 复制整个映射是O(1)，复制之后的写入只分离块数组（每块一个引用）和被修改的那一块，
+// 不会复制全部键值对；后台线程持有快照时，界面线程的每次编辑只复制它碰到的块
+template <typename Key, typename T>
+class ChunkedMap
+{
+    enum { MaxChunk = 256, MinChunk = 64 };
+
+    struct Entry
+    {
+        Key key;
+        T value;
+    };
+    typedef QVector<Entry> Chunk;
+
+public:
+    // 只读迭代器；映射被修改后失效，erase返回新的迭代器
+    class const_iterator
+    {
+    public:
+        const_iterator() : m_chunks(nullptr), m_chunk(0), m_index(0) {}
+        const Key& key() const { return (*m_chunks).at(m_chunk).at(m_index).key; }
+        const T& value() const { return (*m_chunks).at(m_chunk).at(m_index).value; }
+        const_iterator& operator++()
+        {
+            if (++m_index >= (*m_chunks).at(m_chunk).size())
+            {
+                ++m_chunk;
+                m_index = 0;
+            }
+            return *this;
+        }
+        const_iterator& operator--()
+        {
+            if (m_index == 0)
+            {
+                --m_chunk;
+                m_index = (*m_chunks).at(m_chunk).size();
+            }
+            --m_index;
+            return *this;
+        }
+        const_iterator operator-(int count) const
+        {
+            const_iterator it(*this);
+            while (count-- > 0)
+            {
+                --it;
+            }
+            return it;
+        }
+        bool operator==(const const_iterator& other) const { return m_chunk == other.m_chunk && m_index == other.m_index; }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class ChunkedMap;
+        const_iterator(const QVector<Chunk>* chunks, int chunk, int index) : m_chunks(chunks), m_chunk(chunk), m_index(index) {}
+        const QVector<Chunk>* m_chunks;
+        int m_chunk;
+        int m_index;
+    };
+    typedef const_iterator iterator;
+
+    ChunkedMap() : m_size(0) {}
+
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    void clear()
+    {
+        m_chunks.clear();
+        m_size = 0;
+    }
+
+    const_iterator constBegin() const { return const_iterator(&m_chunks, 0, 0); }
+    const_iterator constEnd() const { return const_iterator(&m_chunks, m_chunks.size(), 0); }
+    const_iterator begin() const { return constBegin(); }
+    const_iterator end() const { return constEnd(); }
+
+    // 第一个键 >= key 的项
+    const_iterator lowerBound(const Key& key) const
+    {
+        if (m_chunks.isEmpty())
+        {
+            return constEnd();
+        }
+        int chunk = ChunkFor(key);
+        const Chunk& entries = m_chunks.at(chunk);
+        int index = static_cast<int>(std::lower_bound(entries.constBegin(), entries.constEnd(), key, EntryLess) - entries.constBegin());
+        return At(chunk, index);
+    }
+
+    // 第一个键 > key 的项
+    const_iterator upperBound(const Key& key) const
+    {
+        if (m_chunks.isEmpty())
+        {
+            return constEnd();
+        }
+        int chunk = ChunkFor(key);
+        const Chunk& entries = m_chunks.at(chunk);
+        int index = static_cast<int>(std::upper_bound(entries.constBegin(), entries.constEnd(), key, KeyLess) - entries.constBegin());
+        return At(chunk, index);
+    }
+
+    // 键已存在时替换值；块超过MaxChunk项时对半分开
+    void insert(const Key& key, const T& value)
+    {
+        Entry entry;
+        entry.key = key;
+        entry.value = value;
+        ++m_size;
+        if (m_chunks.isEmpty())
+        {
+            m_chunks.push_back(Chunk());
+            m_chunks[0].push_back(entry);
+            return;
+        }
+        int chunk = ChunkFor(key);
+        Chunk& entries = m_chunks[chunk];
+        int index = static_cast<int>(std::lower_bound(entries.constBegin(), entries.constEnd(), key, EntryLess) - entries.constBegin());
+        if (index < entries.size() && entries.at(index).key == key)
+        {
+            entries[index].value = value;
+            --m_size;
+            return;
+        }
+        entries.insert(index, entry);
+        if (entries.size() > MaxChunk)
+        {
+            Chunk upper = entries.mid(MaxChunk / 2);
+            entries.resize(MaxChunk / 2);
+            m_chunks.insert(chunk + 1, upper);
+        }
+    }
+
+    int remove(const Key& key)
+    {
+        const_iterator it = lowerBound(key);
+        if (it == constEnd() || it.key() != key)
+        {
+            return 0;
+        }
+        EraseAt(it.m_chunk, it.m_index);
+        return 1;
+    }
+
+    // 返回被删除项的下一项
+    const_iterator erase(const_iterator it)
+    {
+        const_iterator next = it;
+        ++next;
+        if (next == constEnd())
+        {
+            EraseAt(it.m_chunk, it.m_index);
+            return constEnd();
+        }
+        Key nextKey = next.key();
+        EraseAt(it.m_chunk, it.m_index);
+        return lowerBound(nextKey);
+    }
+
+    bool operator==(const ChunkedMap& other) const
+    {
+        if (m_size != other.m_size)
+        {
+            return false;
+        }
+        for (const_iterator lhs = constBegin(), rhs = other.constBegin(); lhs != constEnd(); ++lhs, ++rhs)
+        {
+            if (lhs.key() != rhs.key() || !(lhs.value() == rhs.value()))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator!=(const ChunkedMap& other) const { return !(*this == other); }
+
+private:
+    static bool EntryLess(const Entry& entry, const Key& key) { return entry.key < key; }
+    static bool KeyLess(const Key& key, const Entry& entry) { return key < entry.key; }
+    static bool ChunkLess(const Key& key, const Chunk& chunk) { return key < chunk.at(0).key; }
+
+    // 最后一个首键 <= key 的块，key小于所有键时为第0块
+    int ChunkFor(const Key& key) const
+    {
+        int chunk = static_cast<int>(std::upper_bound(m_chunks.constBegin(), m_chunks.constEnd(), key, ChunkLess) - m_chunks.constBegin());
+        return qMax(0, chunk - 1);
+    }
+
+    const_iterator At(int chunk, int index) const
+    {
+        if (index >= m_chunks.at(chunk).size())
+        {
+            return const_iterator(&m_chunks, chunk + 1, 0);
+        }
+        return const_iterator(&m_chunks, chunk, index);
+    }
+
+    // 删空的块直接去掉，太小的块并入相邻块，块数保持在 O(n / MinChunk)
+    void EraseAt(int chunk, int index)
+    {
+        m_chunks[chunk].remove(index);
+        --m_size;
+        int count = m_chunks.at(chunk).size();
+        if (count == 0)
+        {
+            m_chunks.remove(chunk);
+        }
+        else if (count < MinChunk)
+        {
+            if (chunk + 1 < m_chunks.size() && count + m_chunks.at(chunk + 1).size() <= MaxChunk)
+            {
+                Chunk next = m_chunks.at(chunk + 1);
+                m_chunks[chunk] += next;
+                m_chunks.remove(chunk + 1);
+            }
+            else if (chunk > 0 && m_chunks.at(chunk - 1).size() + count <= MaxChunk)
+            {
+                Chunk current = m_chunks.at(chunk);
+                m_chunks[chunk - 1] += current;
+                m_chunks.remove(chunk);
+            }
+        }
+    }
+
+private:
+    QVector<Chunk> m_chunks;
+    int m_size;
+};
+
+#endif // CHUNKEDMAP_H
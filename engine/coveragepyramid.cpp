@@ -0,0 +1,151 @@
+#include "coveragepyramid.h"
+
+// 第0层最多这么多格，单行所有层合计不超过其两倍字节
+static const int MaxBins = 8192;
+
+CoveragePyramid::CoveragePyramid(qint64 budgetBytes)
+    : m_binShift(0)
+    , m_binCount(0)
+{
+    SetBudget(budgetBytes);
+}
+
+void CoveragePyramid::SetSpan(qint64 spanTicks)
+{
+    m_binShift = 0;
+    while ((spanTicks >> m_binShift) >= MaxBins)
+    {
+        ++m_binShift;
+    }
+    m_binCount = static_cast<int>(spanTicks >> m_binShift) + 1;
+    m_rows.clear();
+}
+
+void CoveragePyramid::SetBudget(qint64 budgetBytes)
+{
+    m_rows.setMaxCost(static_cast<int>(qBound(Q_INT64_C(1), budgetBytes/1024, Q_INT64_C(0x7fffffff))));
+}
+
+void CoveragePyramid::Invalidate()
+{
+    m_rows.clear();
+}
+
+void CoveragePyramid::Invalidate(int row)
+{
+    m_rows.remove(row);
+}
+
+bool CoveragePyramid::CanSample(const TimeScale& scale) const
+{
+    return scale.IsValid() && m_binCount > 0
+            && scale.ticksPerPixel >= (Q_INT64_C(1) << (m_binShift + TimeScale::FractionBits));
+}
+
+void CoveragePyramid::Sample(const SelectionIndex& selections, int row, const TimeScale& scale,
+                             int firstPixel, int lastPixel, QVector<quint8>& coverage)
+{
+    coverage.fill(Coverage_Empty, qMax(0, lastPixel - firstPixel + 1));
+    if (coverage.isEmpty() || !CanSample(scale))
+    {
+        return;
+    }
+    const Levels& levels = RowLevels(selections, row);
+
+    // 取格子宽度不超过一个像素的最粗一层，每个像素只合并一到两个格子
+    int level = 0;
+    while (level + 1 < levels.size()
+           && (Q_INT64_C(1) << (m_binShift + level + 1 + TimeScale::FractionBits)) <= scale.ticksPerPixel)
+    {
+        ++level;
+    }
+    const QVector<quint8>& bins = levels[level];
+    int shift = m_binShift + level;
+
+    qint64 pixelStart = qMax(Q_INT64_C(0), scale.ToTick(firstPixel));
+    for (int i = 0; i < coverage.size(); ++i)
+    {
+        qint64 pixelEnd = scale.ToTick(firstPixel + i + 1) - 1;
+        if (pixelEnd >= pixelStart)
+        {
+            int firstBin = static_cast<int>(pixelStart >> shift);
+            int lastBin = static_cast<int>(qMin(static_cast<qint64>(bins.size() - 1), pixelEnd >> shift));
+            if (firstBin <= lastBin)
+            {
+                quint8 state = bins[firstBin];
+                for (int bin = firstBin + 1; bin <= lastBin; ++bin)
+                {
+                    state = Combine(state, bins[bin]);
+                }
+                // 像素边缘和格子边缘不对齐时，边缘格子的满覆盖只说明像素部分被覆盖
+                if (state == Coverage_Full
+                        && ((static_cast<qint64>(firstBin) << shift) > pixelStart
+                            || ((static_cast<qint64>(lastBin + 1) << shift) - 1) < pixelEnd))
+                {
+                    state = Coverage_Partial;
+                }
+                coverage[i] = state;
+            }
+        }
+        pixelStart = qMax(pixelStart, pixelEnd + 1);
+    }
+}
+
+// 各行片段互斥且不相邻，一个格子被完全覆盖时必然只属于一个片段，建层只需一次遍历
+const CoveragePyramid::Levels& CoveragePyramid::RowLevels(const SelectionIndex& selections, int row)
+{
+    Levels* levels = m_rows.object(row);
+    if (levels)
+    {
+        return *levels;
+    }
+
+    levels = new Levels;
+    levels->push_back(QVector<quint8>(m_binCount, Coverage_Empty));
+    QVector<quint8>& base = levels->front();
+    qint64 binSize = Q_INT64_C(1) << m_binShift;
+    const SelectionIndex::RunMap& runs = selections.Runs(row);
+    for (SelectionIndex::RunMap::const_iterator it = runs.constBegin(); it != runs.constEnd(); ++it)
+    {
+        if (it.value() < 0 || (it.key() >> m_binShift) >= m_binCount)
+        {
+            continue;
+        }
+        int firstBin = static_cast<int>(qMax(Q_INT64_C(0), it.key()) >> m_binShift);
+        int lastBin = static_cast<int>(qMin(static_cast<qint64>(m_binCount - 1), it.value() >> m_binShift));
+        for (int bin = firstBin; bin <= lastBin; ++bin)
+        {
+            qint64 binStart = static_cast<qint64>(bin) * binSize;
+            bool full = binStart >= it.key() && binStart + binSize - 1 <= it.value();
+            base[bin] = full ? Coverage_Full : Coverage_Partial;
+        }
+    }
+
+    int bytes = base.size();
+    while (levels->back().size() > 1)
+    {
+        const QVector<quint8>& lower = levels->back();
+        QVector<quint8> upper((lower.size() + 1) / 2);
+        for (int i = 0; i < upper.size(); ++i)
+        {
+            upper[i] = 2*i + 1 < lower.size() ? Combine(lower[2*i], lower[2*i + 1]) : lower[2*i];
+        }
+        bytes += upper.size();
+        levels->push_back(upper);
+    }
+    // 超出整个预算的行不缓存，只保留到下一次取用
+    int cost = qMax(1, bytes / 1024);
+    if (cost > m_rows.maxCost())
+    {
+        m_uncached.swap(*levels);
+        delete levels;
+        return m_uncached;
+    }
+    m_rows.insert(row, levels, cost);
+    return *levels;
+}
+
+quint8 CoveragePyramid::Combine(quint8 lhs, quint8 rhs)
+{
+    return lhs == rhs ? lhs : static_cast<quint8>(Coverage_Partial);
+}
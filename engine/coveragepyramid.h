@@ -0,0 +1,50 @@
+#ifndef COVERAGEPYRAMID_H
+#define COVERAGEPYRAMID_H
+
+#include <QCache>
+#include <QVector>
+#include "rangetypes.h"
+#include "selectionindex.h"
+
+// 每行选择的多分辨率覆盖金字塔
+// 第0层把时间轴切成2的幂个刻度宽的格子，每格记录最小/最大覆盖（空、部分、全满），
+// 往上每层格子宽度翻倍。缩得很小时一个像素对应成百上千个片段，
+// 按像素从合适的层取覆盖状态，绘制代价只和像素数有关
+class CoveragePyramid
+{
+public:
+    enum Coverage {
+        Coverage_Empty,
+        Coverage_Partial,
+        Coverage_Full,
+    };
+
+    explicit CoveragePyramid(qint64 budgetBytes = 32*1024*1024);
+
+    // 时间跨度决定第0层的格子宽度，改变后所有行失效
+    void SetSpan(qint64 spanTicks);
+    void SetBudget(qint64 budgetBytes);
+    void Invalidate();
+    void Invalidate(int row);
+
+    // 每个像素的刻度数不小于第0层格子宽度时才能用金字塔，否则应直接绘制片段
+    bool CanSample(const TimeScale& scale) const;
+    // 取像素[firstPixel, lastPixel]的覆盖状态，像素相对于时间轴起点；该行的金字塔按需建立
+    // 片段边缘所在的格子可能跨两个像素，边缘像素的相邻像素可能被报告为部分覆盖
+    void Sample(const SelectionIndex& selections, int row, const TimeScale& scale,
+                int firstPixel, int lastPixel, QVector<quint8>& coverage);
+
+private:
+    typedef QVector<QVector<quint8> > Levels;
+
+    const Levels& RowLevels(const SelectionIndex& selections, int row);
+    static quint8 Combine(quint8 lhs, quint8 rhs);
+
+private:
+    QCache<int, Levels> m_rows;     // 代价以KB计
+    Levels m_uncached;
+    int m_binShift;                 // 第0层格子宽度为2^m_binShift个刻度
+    int m_binCount;
+};
+
+#endif // COVERAGEPYRAMID_H
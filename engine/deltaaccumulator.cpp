@@ -0,0 +1,69 @@
+#include "deltaaccumulator.h"
+
+DeltaAccumulator::DeltaAccumulator()
+{
+
+}
+
+void DeltaAccumulator::Reset(int rowCount)
+{
+    m_added.Reset(rowCount);
+    m_removed.Reset(rowCount);
+}
+
+bool DeltaAccumulator::IsEmpty() const
+{
+    return m_added.RunCount() == 0 && m_removed.RunCount() == 0;
+}
+
+// 和SelectionIndex::Apply一样先处理移除再处理新增
+// 净新增始终是当前选择的一部分，净移除始终是起始选择的一部分，两者各自满足行间互斥
+void DeltaAccumulator::Append(const SelectionDelta& delta)
+{
+    for (int i = 0; i < delta.removed.size(); ++i)
+    {
+        Cancel(m_added, m_removed, delta.removed[i]);
+    }
+    for (int i = 0; i < delta.added.size(); ++i)
+    {
+        Cancel(m_removed, m_added, delta.added[i]);
+    }
+}
+
+SelectionDelta DeltaAccumulator::Take()
+{
+    SelectionDelta delta;
+    delta.added.reserve(m_added.RunCount());
+    for (SelectionIndex::OrderedIterator it = m_added.OrderedBegin(); it != m_added.OrderedEnd(); ++it)
+    {
+        delta.added.push_back(*it);
+    }
+    delta.removed.reserve(m_removed.RunCount());
+    for (SelectionIndex::OrderedIterator it = m_removed.OrderedBegin(); it != m_removed.OrderedEnd(); ++it)
+    {
+        delta.removed.push_back(*it);
+    }
+    Reset(m_added.RowCount());
+    return delta;
+}
+
+// 先从对方集合中挖掉重叠部分，剩余部分并入自己的集合
+void DeltaAccumulator::Cancel(SelectionIndex& opposite, SelectionIndex& own, const RowSpan& span)
+{
+    QVector<RowSpan> cancelled = opposite.Subtract(span.row, span.start, span.end).removed;
+    SelectionDelta rest;
+    qint64 cursor = span.start;
+    for (int i = 0; i < cancelled.size(); ++i)
+    {
+        if (cancelled[i].start > cursor)
+        {
+            rest.added.push_back(RowSpan(span.row, cursor, cancelled[i].start - 1));
+        }
+        cursor = qMax(cursor, cancelled[i].end + 1);
+    }
+    if (cursor <= span.end)
+    {
+        rest.added.push_back(RowSpan(span.row, cursor, span.end));
+    }
+    own.Apply(rest);
+}
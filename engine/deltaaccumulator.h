@@ -0,0 +1,30 @@
+#ifndef DELTAACCUMULATOR_H
+#define DELTAACCUMULATOR_H
+
+#include "rangetypes.h"
+#include "selectionindex.h"
+
+// 把连续多次编辑的变化合成一次净变化
+// 新增和移除各用一个索引保存：新移除的部分先抵消之前新增的，新增的部分先抵消之前移除的，
+// 剩余部分才并入，因此先增后删的范围不会出现在结果中，代价只和变化大小有关
+class DeltaAccumulator
+{
+public:
+    DeltaAccumulator();
+
+    void Reset(int rowCount);
+    bool IsEmpty() const;
+
+    void Append(const SelectionDelta& delta);
+    // 取出净变化（按时间顺序）并清空
+    SelectionDelta Take();
+
+private:
+    static void Cancel(SelectionIndex& opposite, SelectionIndex& own, const RowSpan& span);
+
+private:
+    SelectionIndex m_added;
+    SelectionIndex m_removed;
+};
+
+#endif // DELTAACCUMULATOR_H
@@ -0,0 +1,13 @@
+# 使用选择引擎的工程包含此文件
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+# qmake CONFIG+=vmerge_trace 打开耗时统计
+vmerge_trace: DEFINES += VMERGE_TRACE
+
+VMENGINE_DIR = $$shadowed($$PWD)
+win32:CONFIG(release, debug|release): VMENGINE_DIR = $$VMENGINE_DIR/release
+else:win32:CONFIG(debug, debug|release): VMENGINE_DIR = $$VMENGINE_DIR/debug
+
+LIBS += -L$$VMENGINE_DIR -lvmengine
+win32-msvc*: PRE_TARGETDEPS += $$VMENGINE_DIR/vmengine.lib
+else: PRE_TARGETDEPS += $$VMENGINE_DIR/libvmengine.a
@@ -0,0 +1,43 @@
+#-------------------------------------------------
+#
+# 选择引擎：行间互斥选择、撤销重做、工程文件和时间换算
+# 只依赖QtCore，可以在没有显示设备的批处理服务中使用
+#
+#-------------------------------------------------
+
+QT       = core
+
+TARGET = vmengine
+TEMPLATE = lib
+CONFIG += staticlib c++11
+
+DEFINES += QT_DEPRECATED_WARNINGS
+vmerge_trace: DEFINES += VMERGE_TRACE
+
+SOURCES += \
+        selectionindex.cpp \
+        selectionhistory.cpp \
+        selectionengine.cpp \
+        deltaaccumulator.cpp \
+        coveragepyramid.cpp \
+        activitypyramid.cpp \
+        snapindex.cpp \
+        rangeset.cpp \
+        selectionsnapshot.cpp \
+        tracer.cpp \
+        projectfile.cpp
+
+HEADERS += \
+        rangetypes.h \
+        chunkedmap.h \
+        selectionindex.h \
+        selectionhistory.h \
+        selectionengine.h \
+        deltaaccumulator.h \
+        coveragepyramid.h \
+        activitypyramid.h \
+        snapindex.h \
+        rangeset.h \
+        selectionsnapshot.h \
+        tracer.h \
+        projectfile.h
@@ -0,0 +1,538 @@
+#include "projectfile.h"
+
+#include <QSaveFile>
+#include <QtEndian>
+#include <string.h>
+
+// 文件头（48字节，小端）
+//  0 magic       u32       4 version     u16      6 保留 u16
+//  8 刻度/秒     u32      12 行数        u32     16 列数 u32    20 保留 u32
+// 24 时间跨度    i64      32 标签区偏移  u64     40 行表偏移 u64
+// 行表每行16字节：片段区偏移 u64，片段数 u32，片段区长度 u32
+// 片段区：zigzag(起点-上一段终点) + varint(终点-起点)，逐段重复
+static const quint32 ProjectMagic = 0x4a504d56;   // "VMPJ"
+static const quint32 JournalMagic = 0x4c4a4d56;   // "VMJL"
+static const int HeaderSize = 48;
+static const int RowEntrySize = 16;
+static const int JournalHeaderSize = 16;
+static const quint16 JournalVersion = 2;
+
+template <typename T>
+static void AppendFixed(QByteArray& out, T value)
+{
+    T littleEndian = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char*>(&littleEndian), sizeof(T));
+}
+
+template <typename T>
+static void PutFixed(QByteArray& out, int offset, T value)
+{
+    T littleEndian = qToLittleEndian(value);
+    memcpy(out.data() + offset, &littleEndian, sizeof(T));
+}
+
+template <typename T>
+static T GetFixed(const uchar* data)
+{
+    return qFromLittleEndian<T>(data);
+}
+
+static void AppendVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80)
+    {
+        out.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+static bool ReadVarint(const uchar*& data, const uchar* end, quint64& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && data < end; shift += 7)
+    {
+        uchar byte = *data++;
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static quint64 ZigZag(qint64 value)
+{
+    return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+}
+
+static qint64 UnZigZag(quint64 value)
+{
+    return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+}
+
+// 快照内容的FNV-1a散列，日志据此确认自己是在哪个快照之后写的
+static quint64 SnapshotIdentity(const uchar* data, qint64 size)
+{
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    for (qint64 i = 0; i < size; ++i)
+    {
+        hash = (hash ^ data[i]) * Q_UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+static void AppendString(QByteArray& out, const QString& text)
+{
+    QByteArray utf8 = text.toUtf8();
+    AppendVarint(out, utf8.size());
+    out.append(utf8);
+}
+
+static bool ReadString(const uchar*& data, const uchar* end, QString& text)
+{
+    quint64 length = 0;
+    if (!ReadVarint(data, end, length) || length > static_cast<quint64>(end - data))
+    {
+        return false;
+    }
+    text = QString::fromUtf8(reinterpret_cast<const char*>(data), static_cast<int>(length));
+    data += length;
+    return true;
+}
+
+static void AppendSpans(QByteArray& out, const QVector<RowSpan>& spans)
+{
+    for (int i = 0; i < spans.size(); ++i)
+    {
+        AppendVarint(out, spans[i].row);
+        AppendVarint(out, ZigZag(spans[i].start));
+        AppendVarint(out, spans[i].end - spans[i].start);
+    }
+}
+
+static bool ReadSpans(const uchar*& data, const uchar* end, quint64 count, QVector<RowSpan>& spans)
+{
+    for (quint64 i = 0; i < count; ++i)
+    {
+        quint64 row = 0, start = 0, length = 0;
+        if (!ReadVarint(data, end, row) || !ReadVarint(data, end, start) || !ReadVarint(data, end, length))
+        {
+            return false;
+        }
+        qint64 spanStart = UnZigZag(start);
+        spans.push_back(RowSpan(static_cast<int>(row), spanStart, spanStart + static_cast<qint64>(length)));
+    }
+    return true;
+}
+
+ProjectFile::ProjectFile()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_identity(0)
+{
+
+}
+
+ProjectFile::~ProjectFile()
+{
+    Close();
+}
+
+bool ProjectFile::Save(const QString& path, int ticksPerSecond, qint64 timeSpanTicks,
+                       const QStringList& rowLabels, const QStringList& columnLabels,
+                       const SelectionIndex& selections, quint64* identity)
+{
+    int rowCount = selections.RowCount();
+    QByteArray out(HeaderSize, '\0');
+    out.reserve(HeaderSize + rowCount * RowEntrySize + selections.RunCount() * 6);
+
+    qint64 labelsOffset = out.size();
+    AppendVarint(out, columnLabels.size());
+    for (int i = 0; i < columnLabels.size(); ++i)
+    {
+        AppendString(out, columnLabels[i]);
+    }
+    AppendVarint(out, rowLabels.size());
+    for (int i = 0; i < rowLabels.size(); ++i)
+    {
+        AppendString(out, rowLabels[i]);
+    }
+
+    int rowTableOffset = out.size();
+    out.append(QByteArray(rowCount * RowEntrySize, '\0'));
+    for (int row = 0; row < rowCount; ++row)
+    {
+        const SelectionIndex::RunMap& runs = selections.Runs(row);
+        int runsOffset = out.size();
+        qint64 previousEnd = 0;
+        for (SelectionIndex::RunMap::const_iterator it = runs.constBegin(); it != runs.constEnd(); ++it)
+        {
+            AppendVarint(out, ZigZag(it.key() - previousEnd));
+            AppendVarint(out, it.value() - it.key());
+            previousEnd = it.value();
+        }
+        int entry = rowTableOffset + row * RowEntrySize;
+        PutFixed<quint64>(out, entry, runsOffset);
+        PutFixed<quint32>(out, entry + 8, runs.size());
+        PutFixed<quint32>(out, entry + 12, out.size() - runsOffset);
+    }
+
+    PutFixed<quint32>(out, 0, ProjectMagic);
+    PutFixed<quint16>(out, 4, Version);
+    PutFixed<quint32>(out, 8, ticksPerSecond);
+    PutFixed<quint32>(out, 12, rowCount);
+    PutFixed<quint32>(out, 16, columnLabels.size());
+    PutFixed<qint64>(out, 24, timeSpanTicks);
+    PutFixed<quint64>(out, 32, labelsOffset);
+    PutFixed<quint64>(out, 40, rowTableOffset);
+    if (identity)
+    {
+        *identity = SnapshotIdentity(reinterpret_cast<const uchar*>(out.constData()), out.size());
+    }
+
+    // 先写临时文件再替换，保存中途失败不会破坏原有快照
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(out) != out.size())
+    {
+        return false;
+    }
+    return file.commit();
+}
+
+bool ProjectFile::Open(const QString& path)
+{
+    Close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < HeaderSize)
+    {
+        Close();
+        return false;
+    }
+    m_size = m_file.size();
+    m_data = m_file.map(0, m_size);
+    if (!m_data
+            || GetFixed<quint32>(m_data) != ProjectMagic
+            || GetFixed<quint16>(m_data + 4) != Version
+            || GetFixed<quint64>(m_data + 32) > static_cast<quint64>(m_size)
+            || GetFixed<quint64>(m_data + 40) + static_cast<quint64>(RowCount()) * RowEntrySize > static_cast<quint64>(m_size))
+    {
+        Close();
+        return false;
+    }
+    m_identity = SnapshotIdentity(m_data, m_size);
+    return true;
+}
+
+void ProjectFile::Close()
+{
+    if (m_data)
+    {
+        m_file.unmap(const_cast<uchar*>(m_data));
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_identity = 0;
+    m_file.close();
+}
+
+bool ProjectFile::IsOpen() const
+{
+    return m_data != nullptr;
+}
+
+quint64 ProjectFile::Identity() const
+{
+    return m_identity;
+}
+
+int ProjectFile::TicksPerSecond() const
+{
+    return m_data ? static_cast<int>(GetFixed<quint32>(m_data + 8)) : 0;
+}
+
+qint64 ProjectFile::TimeSpanTicks() const
+{
+    return m_data ? GetFixed<qint64>(m_data + 24) : 0;
+}
+
+int ProjectFile::RowCount() const
+{
+    return m_data ? static_cast<int>(GetFixed<quint32>(m_data + 12)) : 0;
+}
+
+int ProjectFile::ColumnCount() const
+{
+    return m_data ? static_cast<int>(GetFixed<quint32>(m_data + 16)) : 0;
+}
+
+QStringList ProjectFile::RowLabels() const
+{
+    QStringList rowLabels;
+    ReadLabels(&rowLabels, nullptr);
+    return rowLabels;
+}
+
+QStringList ProjectFile::ColumnLabels() const
+{
+    QStringList columnLabels;
+    ReadLabels(nullptr, &columnLabels);
+    return columnLabels;
+}
+
+int ProjectFile::RunCount(int row) const
+{
+    if (!m_data || row < 0 || row >= RowCount())
+    {
+        return 0;
+    }
+    return static_cast<int>(GetFixed<quint32>(m_data + GetFixed<quint64>(m_data + 40) + row * RowEntrySize + 8));
+}
+
+// 只解码这一行的片段
+bool ProjectFile::ReadRuns(int row, QVector<TickRange>& runs) const
+{
+    runs.clear();
+    if (!m_data || row < 0 || row >= RowCount())
+    {
+        return false;
+    }
+    const uchar* entry = m_data + GetFixed<quint64>(m_data + 40) + row * RowEntrySize;
+    quint64 offset = GetFixed<quint64>(entry);
+    quint32 count = GetFixed<quint32>(entry + 8);
+    quint32 length = GetFixed<quint32>(entry + 12);
+    if (offset + length > static_cast<quint64>(m_size))
+    {
+        return false;
+    }
+
+    const uchar* data = m_data + offset;
+    const uchar* end = data + length;
+    runs.reserve(count);
+    qint64 previousEnd = 0;
+    for (quint32 i = 0; i < count; ++i)
+    {
+        quint64 gap = 0, span = 0;
+        if (!ReadVarint(data, end, gap) || !ReadVarint(data, end, span))
+        {
+            return false;
+        }
+        qint64 begin = previousEnd + UnZigZag(gap);
+        previousEnd = begin + static_cast<qint64>(span);
+        runs.push_back(TickRange(begin, previousEnd));
+    }
+    return true;
+}
+
+bool ProjectFile::LoadInto(SelectionIndex& selections) const
+{
+    if (!m_data)
+    {
+        return false;
+    }
+    selections.Reset(RowCount());
+    QVector<TickRange> runs;
+    for (int row = 0; row < RowCount(); ++row)
+    {
+        if (!ReadRuns(row, runs))
+        {
+            return false;
+        }
+        SelectionDelta delta;
+        delta.added.reserve(runs.size());
+        for (int i = 0; i < runs.size(); ++i)
+        {
+            delta.added.push_back(RowSpan(row, runs[i].begin, runs[i].end));
+        }
+        selections.Apply(delta);
+    }
+    return true;
+}
+
+bool ProjectFile::ReadLabels(QStringList* rowLabels, QStringList* columnLabels) const
+{
+    if (!m_data)
+    {
+        return false;
+    }
+    const uchar* data = m_data + GetFixed<quint64>(m_data + 32);
+    const uchar* end = m_data + m_size;
+    QStringList* lists[2] = { columnLabels, rowLabels };
+    for (int i = 0; i < 2; ++i)
+    {
+        quint64 count = 0;
+        if (!ReadVarint(data, end, count))
+        {
+            return false;
+        }
+        for (quint64 j = 0; j < count; ++j)
+        {
+            QString text;
+            if (!ReadString(data, end, text))
+            {
+                return false;
+            }
+            if (lists[i])
+            {
+                lists[i]->push_back(text);
+            }
+        }
+    }
+    return true;
+}
+
+// 日志文件头：magic u32，version u16，保留 u16，快照标识 u64
+// 每条记录：varint(负载长度) + 负载 + u16校验；负载为varint(移除数) varint(添加数)和各片段
+// 扫描到第一条不完整或校验失败的记录为止，返回有效部分的长度
+// 版本或快照标识不符时返回-1：记录是针对别的快照写的，重放会把已属于其他行的范围再加给本行，破坏行间互斥
+static qint64 ScanJournal(const QByteArray& bytes, quint64 snapshot, SelectionIndex* selections, int* recordCount)
+{
+    const uchar* begin = reinterpret_cast<const uchar*>(bytes.constData());
+    if (bytes.size() < JournalHeaderSize
+            || GetFixed<quint32>(begin) != JournalMagic
+            || GetFixed<quint16>(begin + 4) != JournalVersion
+            || GetFixed<quint64>(begin + 8) != snapshot)
+    {
+        return -1;
+    }
+    const uchar* data = begin + JournalHeaderSize;
+    const uchar* end = begin + bytes.size();
+    qint64 validEnd = JournalHeaderSize;
+    int count = 0;
+    while (data < end)
+    {
+        quint64 length = 0;
+        if (!ReadVarint(data, end, length) || length + 2 > static_cast<quint64>(end - data))
+        {
+            break;
+        }
+        const uchar* payload = data;
+        const uchar* payloadEnd = data + length;
+        if (qChecksum(reinterpret_cast<const char*>(payload), static_cast<uint>(length)) != GetFixed<quint16>(payloadEnd))
+        {
+            break;
+        }
+
+        SelectionDelta delta;
+        quint64 removedCount = 0, addedCount = 0;
+        if (!ReadVarint(payload, payloadEnd, removedCount) || !ReadVarint(payload, payloadEnd, addedCount)
+                || !ReadSpans(payload, payloadEnd, removedCount, delta.removed)
+                || !ReadSpans(payload, payloadEnd, addedCount, delta.added))
+        {
+            break;
+        }
+        if (selections)
+        {
+            selections->Apply(delta);
+        }
+        data = payloadEnd + 2;
+        validEnd = data - begin;
+        ++count;
+    }
+    if (recordCount)
+    {
+        *recordCount = count;
+    }
+    return validEnd;
+}
+
+ProjectJournal::ProjectJournal()
+{
+
+}
+
+ProjectJournal::~ProjectJournal()
+{
+    Close();
+}
+
+static QByteArray JournalHeader(quint64 snapshot)
+{
+    QByteArray header;
+    AppendFixed<quint32>(header, JournalMagic);
+    AppendFixed<quint16>(header, JournalVersion);
+    AppendFixed<quint16>(header, 0);
+    AppendFixed<quint64>(header, snapshot);
+    return header;
+}
+
+bool ProjectJournal::Open(const QString& path, quint64 snapshot)
+{
+    Close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite))
+    {
+        return false;
+    }
+    if (m_file.size() == 0)
+    {
+        QByteArray header = JournalHeader(snapshot);
+        if (m_file.write(header) != header.size())
+        {
+            Close();
+            return false;
+        }
+    }
+
+    // 上次写到一半的记录截掉，否则之后追加的记录无法重放
+    m_file.seek(0);
+    qint64 validEnd = ScanJournal(m_file.readAll(), snapshot, nullptr, nullptr);
+    if (validEnd < 0 || !m_file.resize(validEnd) || !m_file.seek(validEnd))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void ProjectJournal::Close()
+{
+    m_file.close();
+}
+
+bool ProjectJournal::IsOpen() const
+{
+    return m_file.isOpen();
+}
+
+bool ProjectJournal::Append(const SelectionDelta& delta)
+{
+    if (!m_file.isOpen() || delta.IsEmpty())
+    {
+        return false;
+    }
+    QByteArray payload;
+    AppendVarint(payload, delta.removed.size());
+    AppendVarint(payload, delta.added.size());
+    AppendSpans(payload, delta.removed);
+    AppendSpans(payload, delta.added);
+
+    QByteArray record;
+    AppendVarint(record, payload.size());
+    record.append(payload);
+    AppendFixed<quint16>(record, qChecksum(payload.constData(), static_cast<uint>(payload.size())));
+    return m_file.write(record) == record.size() && m_file.flush();
+}
+
+// 先清空记录再写入新的快照标识；两步之间中断时日志为空或只剩文件头，都不会被错误重放
+bool ProjectJournal::Reset(quint64 snapshot)
+{
+    if (!m_file.isOpen() || !m_file.resize(JournalHeaderSize) || !m_file.seek(0))
+    {
+        return false;
+    }
+    QByteArray header = JournalHeader(snapshot);
+    return m_file.write(header) == header.size() && m_file.flush();
+}
+
+int ProjectJournal::Replay(const QString& path, quint64 snapshot, SelectionIndex& selections)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return -1;
+    }
+    int count = 0;
+    return ScanJournal(file.readAll(), snapshot, &selections, &count) < 0 ? -1 : count;
+}
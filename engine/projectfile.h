@@ -0,0 +1,80 @@
+#ifndef PROJECTFILE_H
+#define PROJECTFILE_H
+
+#include <QFile>
+#include <QStringList>
+#include <QVector>
+#include "rangetypes.h"
+#include "selectionindex.h"
+
+// 二进制工程快照
+// 文件头和行表是定长小端格式，映射到内存后可以直接按行定位；
+// 每行的片段用差分varint编码，ReadRuns只解码被读取的那一行，查看文件内容不需要解析整个文件
+class ProjectFile
+{
+public:
+    enum { Version = 1 };
+
+    ProjectFile();
+    ~ProjectFile();
+
+    static bool Save(const QString& path, int ticksPerSecond, qint64 timeSpanTicks,
+                     const QStringList& rowLabels, const QStringList& columnLabels,
+                     const SelectionIndex& selections, quint64* identity = nullptr);
+
+    bool Open(const QString& path);
+    void Close();
+    bool IsOpen() const;
+    // 快照内容的散列，和Save给出的identity相同；日志用它确认对应的快照
+    quint64 Identity() const;
+
+    int TicksPerSecond() const;
+    qint64 TimeSpanTicks() const;
+    int RowCount() const;
+    int ColumnCount() const;
+    QStringList RowLabels() const;
+    QStringList ColumnLabels() const;
+
+    int RunCount(int row) const;
+    bool ReadRuns(int row, QVector<TickRange>& runs) const;
+    // 解码所有行并建立索引。行间互斥、按位置查行和按时间顺序导出都依赖全局覆盖表，
+    // 它必须包含每一行的片段，所以载入到索引时无法按需解码；解码本身是一次线性扫描
+    bool LoadInto(SelectionIndex& selections) const;
+
+private:
+    bool ReadLabels(QStringList* rowLabels, QStringList* columnLabels) const;
+
+private:
+    QFile m_file;
+    const uchar* m_data;
+    qint64 m_size;
+    quint64 m_identity;
+};
+
+// 追加式编辑日志
+// 每次编辑只追加它造成的变化，几十个字节；打开工程时在快照之后重放。
+// 每条记录带长度和校验，写到一半的最后一条记录在重放时被忽略。
+// 文件头记下所基于快照的标识（ProjectFile::Identity），和快照不符的日志拒绝打开和重放
+class ProjectJournal
+{
+public:
+    ProjectJournal();
+    ~ProjectJournal();
+
+    // 新建的日志记下snapshot；已有的日志必须基于同一个快照
+    bool Open(const QString& path, quint64 snapshot);
+    void Close();
+    bool IsOpen() const;
+
+    bool Append(const SelectionDelta& delta);
+    // 保存快照后调用，之前的记录都已包含在快照中，之后的记录基于新的快照
+    bool Reset(quint64 snapshot);
+
+    // 返回重放的记录数，文件无效或不是基于snapshot时返回-1，此时selections不变
+    static int Replay(const QString& path, quint64 snapshot, SelectionIndex& selections);
+
+private:
+    QFile m_file;
+};
+
+#endif // PROJECTFILE_H
@@ -0,0 +1,434 @@
+#include "rangeset.h"
+
+#include <QtAlgorithms>
+#include <algorithm>
+
+// 平均每个片段连同间隔的刻度数低于此值时用位图保存，此时位图比区间数组更省空间
+static const qint64 DenseSpan = 128;
+// 位图最多这么多位（8MB），跨度更大的集合总是保存为区间
+static const qint64 MaxDenseBits = Q_INT64_C(1) << 26;
+
+static qint64 FloorTo64(qint64 tick)
+{
+    return tick - (((tick % 64) + 64) % 64);
+}
+
+RangeSet::RangeSet()
+    : m_origin(0)
+    , m_dense(false)
+{
+
+}
+
+RangeSet::RangeSet(const QVector<TickRange>& ranges)
+    : m_origin(0)
+    , m_dense(false)
+{
+    QVector<TickRange> sorted;
+    sorted.reserve(ranges.size());
+    for (int i = 0; i < ranges.size(); ++i)
+    {
+        if (ranges[i].begin <= ranges[i].end)
+        {
+            sorted.push_back(ranges[i]);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const TickRange& lhs, const TickRange& rhs) { return lhs.begin < rhs.begin; });
+    for (int i = 0; i < sorted.size(); ++i)
+    {
+        if (!m_runs.isEmpty() && sorted[i].begin <= m_runs.back().end + 1)
+        {
+            m_runs.back().end = qMax(m_runs.back().end, sorted[i].end);
+        }
+        else
+        {
+            m_runs.push_back(sorted[i]);
+        }
+    }
+    Compact();
+}
+
+// 一行的选择本身已经有序且不相邻，直接使用
+RangeSet RangeSet::FromRuns(const SelectionIndex::RunMap& runs)
+{
+    QVector<TickRange> ranges;
+    ranges.reserve(runs.size());
+    for (SelectionIndex::RunMap::const_iterator it = runs.constBegin(); it != runs.constEnd(); ++it)
+    {
+        ranges.push_back(TickRange(it.key(), it.value()));
+    }
+    return FromSortedRuns(ranges);
+}
+
+bool RangeSet::IsEmpty() const
+{
+    return m_dense ? m_bits.isEmpty() : m_runs.isEmpty();
+}
+
+bool RangeSet::IsDense() const
+{
+    return m_dense;
+}
+
+int RangeSet::RunCount() const
+{
+    return m_dense ? Ranges().size() : m_runs.size();
+}
+
+qint64 RangeSet::Length() const
+{
+    qint64 length = 0;
+    if (m_dense)
+    {
+        for (int i = 0; i < m_bits.size(); ++i)
+        {
+            length += qPopulationCount(m_bits[i]);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < m_runs.size(); ++i)
+        {
+            length += m_runs[i].end - m_runs[i].begin + 1;
+        }
+    }
+    return length;
+}
+
+bool RangeSet::Contains(qint64 tick) const
+{
+    if (m_dense)
+    {
+        qint64 offset = tick - m_origin;
+        return offset >= 0 && offset < static_cast<qint64>(m_bits.size()) * 64
+                && (m_bits[static_cast<int>(offset / 64)] >> (offset % 64)) & 1;
+    }
+    QVector<TickRange>::const_iterator it = std::upper_bound(m_runs.constBegin(), m_runs.constEnd(), tick,
+                                                            [](qint64 value, const TickRange& range) { return value < range.begin; });
+    return it != m_runs.constBegin() && (it - 1)->end >= tick;
+}
+
+// 位图逐字扫描，全0和全1的字整体跳过
+QVector<TickRange> RangeSet::Ranges() const
+{
+    if (!m_dense)
+    {
+        return m_runs;
+    }
+    QVector<TickRange> ranges;
+    bool inRun = false;
+    qint64 start = 0;
+    for (int i = 0; i < m_bits.size(); ++i)
+    {
+        quint64 word = m_bits[i];
+        if ((!inRun && word == 0) || (inRun && word == ~Q_UINT64_C(0)))
+        {
+            continue;
+        }
+        for (int bit = 0; bit < 64; ++bit)
+        {
+            bool set = (word >> bit) & 1;
+            if (set != inRun)
+            {
+                qint64 tick = m_origin + static_cast<qint64>(i) * 64 + bit;
+                if (set)
+                {
+                    start = tick;
+                }
+                else
+                {
+                    ranges.push_back(TickRange(start, tick - 1));
+                }
+                inRun = set;
+            }
+        }
+    }
+    if (inRun)
+    {
+        ranges.push_back(TickRange(start, m_origin + static_cast<qint64>(m_bits.size()) * 64 - 1));
+    }
+    return ranges;
+}
+
+RangeSet RangeSet::Union(const RangeSet& other) const
+{
+    return Combine(other, Operation_Union);
+}
+
+RangeSet RangeSet::Intersection(const RangeSet& other) const
+{
+    return Combine(other, Operation_Intersection);
+}
+
+RangeSet RangeSet::Difference(const RangeSet& other) const
+{
+    return Combine(other, Operation_Difference);
+}
+
+RangeSet RangeSet::Complement(qint64 begin, qint64 end) const
+{
+    if (begin > end)
+    {
+        return RangeSet();
+    }
+    QVector<TickRange> whole;
+    whole.push_back(TickRange(begin, end));
+    return FromSortedRuns(whole).Difference(*this);
+}
+
+bool RangeSet::operator == (const RangeSet& other) const
+{
+    QVector<TickRange> lhs = Ranges();
+    QVector<TickRange> rhs = other.Ranges();
+    if (lhs.size() != rhs.size())
+    {
+        return false;
+    }
+    for (int i = 0; i < lhs.size(); ++i)
+    {
+        if (lhs[i].begin != rhs[i].begin || lhs[i].end != rhs[i].end)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RangeSet::operator != (const RangeSet& other) const
+{
+    return !(*this == other);
+}
+
+// 两边都是位图时按字运算，否则归并区间；结果再按碎片程度选择保存方式
+RangeSet RangeSet::Combine(const RangeSet& other, Operation operation) const
+{
+    if (m_dense && other.m_dense)
+    {
+        qint64 begin = qMin(m_origin, other.m_origin);
+        qint64 end = qMax(m_origin + static_cast<qint64>(m_bits.size()) * 64, other.m_origin + static_cast<qint64>(other.m_bits.size()) * 64);
+        if (end - begin <= MaxDenseBits)
+        {
+            return MergeBits(*this, other, operation);
+        }
+    }
+    return FromSortedRuns(MergeRuns(Ranges(), other.Ranges(), operation));
+}
+
+RangeSet RangeSet::FromSortedRuns(const QVector<TickRange>& runs)
+{
+    RangeSet set;
+    set.m_runs = runs;
+    set.Compact();
+    return set;
+}
+
+QVector<TickRange> RangeSet::MergeRuns(const QVector<TickRange>& lhs, const QVector<TickRange>& rhs, Operation operation)
+{
+    QVector<TickRange> result;
+    int i = 0;
+    int j = 0;
+    switch (operation)
+    {
+    case Operation_Union:
+        result.reserve(lhs.size() + rhs.size());
+        while (i < lhs.size() || j < rhs.size())
+        {
+            const TickRange& next = (j >= rhs.size() || (i < lhs.size() && lhs[i].begin <= rhs[j].begin)) ? lhs[i++] : rhs[j++];
+            if (!result.isEmpty() && next.begin <= result.back().end + 1)
+            {
+                result.back().end = qMax(result.back().end, next.end);
+            }
+            else
+            {
+                result.push_back(next);
+            }
+        }
+        break;
+    case Operation_Intersection:
+        while (i < lhs.size() && j < rhs.size())
+        {
+            qint64 begin = qMax(lhs[i].begin, rhs[j].begin);
+            qint64 end = qMin(lhs[i].end, rhs[j].end);
+            if (begin <= end)
+            {
+                result.push_back(TickRange(begin, end));
+            }
+            if (lhs[i].end < rhs[j].end)
+            {
+                ++i;
+            }
+            else
+            {
+                ++j;
+            }
+        }
+        break;
+    case Operation_Difference:
+        for (; i < lhs.size(); ++i)
+        {
+            qint64 current = lhs[i].begin;
+            while (j < rhs.size() && rhs[j].end < current)
+            {
+                ++j;
+            }
+            // 跨过本段终点的减数片段可能还会覆盖下一段，不跳过它
+            for (int k = j; k < rhs.size() && rhs[k].begin <= lhs[i].end; ++k)
+            {
+                if (rhs[k].begin > current)
+                {
+                    result.push_back(TickRange(current, rhs[k].begin - 1));
+                }
+                current = qMax(current, rhs[k].end + 1);
+                if (rhs[k].end >= lhs[i].end)
+                {
+                    break;
+                }
+            }
+            if (current <= lhs[i].end)
+            {
+                result.push_back(TickRange(current, lhs[i].end));
+            }
+        }
+        break;
+    }
+    return result;
+}
+
+RangeSet RangeSet::MergeBits(const RangeSet& lhs, const RangeSet& rhs, Operation operation)
+{
+    qint64 lhsEnd = lhs.m_origin + static_cast<qint64>(lhs.m_bits.size()) * 64;
+    qint64 rhsEnd = rhs.m_origin + static_cast<qint64>(rhs.m_bits.size()) * 64;
+    qint64 begin = lhs.m_origin;
+    qint64 end = lhsEnd;
+    if (operation == Operation_Union)
+    {
+        begin = qMin(lhs.m_origin, rhs.m_origin);
+        end = qMax(lhsEnd, rhsEnd);
+    }
+    else if (operation == Operation_Intersection)
+    {
+        begin = qMax(lhs.m_origin, rhs.m_origin);
+        end = qMin(lhsEnd, rhsEnd);
+    }
+
+    RangeSet set;
+    set.m_dense = true;
+    set.m_origin = begin;
+    if (end > begin)
+    {
+        set.m_bits.resize(static_cast<int>((end - begin) / 64));
+        int lhsOffset = static_cast<int>((begin - lhs.m_origin) / 64);
+        int rhsOffset = static_cast<int>((begin - rhs.m_origin) / 64);
+        for (int i = 0; i < set.m_bits.size(); ++i)
+        {
+            int l = i + lhsOffset;
+            int r = i + rhsOffset;
+            quint64 lhsWord = l >= 0 && l < lhs.m_bits.size() ? lhs.m_bits[l] : 0;
+            quint64 rhsWord = r >= 0 && r < rhs.m_bits.size() ? rhs.m_bits[r] : 0;
+            switch (operation)
+            {
+            case Operation_Union:
+                set.m_bits[i] = lhsWord | rhsWord;
+                break;
+            case Operation_Intersection:
+                set.m_bits[i] = lhsWord & rhsWord;
+                break;
+            case Operation_Difference:
+                set.m_bits[i] = lhsWord & ~rhsWord;
+                break;
+            }
+        }
+    }
+    set.Compact();
+    return set;
+}
+
+// 按平均每个片段的跨度选择保存方式，位图去掉两端的全0字
+void RangeSet::Compact()
+{
+    if (!m_dense)
+    {
+        if (m_runs.isEmpty())
+        {
+            return;
+        }
+        qint64 span = m_runs.back().end - FloorTo64(m_runs.front().begin) + 1;
+        if (span <= MaxDenseBits && span < DenseSpan * m_runs.size())
+        {
+            ToDense();
+        }
+        return;
+    }
+
+    int first = 0;
+    int last = m_bits.size() - 1;
+    while (first <= last && m_bits[first] == 0)
+    {
+        ++first;
+    }
+    while (last >= first && m_bits[last] == 0)
+    {
+        --last;
+    }
+    if (first > last)
+    {
+        m_bits.clear();
+        m_origin = 0;
+        m_dense = false;
+        return;
+    }
+    if (first > 0 || last < m_bits.size() - 1)
+    {
+        m_bits = m_bits.mid(first, last - first + 1);
+        m_origin += static_cast<qint64>(first) * 64;
+    }
+
+    // 片段数即0到1的跳变数
+    qint64 runs = 0;
+    quint64 carry = 0;
+    for (int i = 0; i < m_bits.size(); ++i)
+    {
+        runs += qPopulationCount(m_bits[i] & ~((m_bits[i] << 1) | carry));
+        carry = m_bits[i] >> 63;
+    }
+    if (static_cast<qint64>(m_bits.size()) * 64 >= DenseSpan * runs)
+    {
+        ToRuns();
+    }
+}
+
+void RangeSet::ToDense()
+{
+    m_origin = FloorTo64(m_runs.front().begin);
+    m_bits.fill(0, static_cast<int>((m_runs.back().end - m_origin) / 64 + 1));
+    for (int i = 0; i < m_runs.size(); ++i)
+    {
+        qint64 begin = m_runs[i].begin - m_origin;
+        qint64 end = m_runs[i].end - m_origin;
+        int firstWord = static_cast<int>(begin / 64);
+        int lastWord = static_cast<int>(end / 64);
+        quint64 firstMask = ~Q_UINT64_C(0) << (begin % 64);
+        quint64 lastMask = ~Q_UINT64_C(0) >> (63 - end % 64);
+        if (firstWord == lastWord)
+        {
+            m_bits[firstWord] |= firstMask & lastMask;
+            continue;
+        }
+        m_bits[firstWord] |= firstMask;
+        for (int word = firstWord + 1; word < lastWord; ++word)
+        {
+            m_bits[word] = ~Q_UINT64_C(0);
+        }
+        m_bits[lastWord] |= lastMask;
+    }
+    m_runs.clear();
+    m_dense = true;
+}
+
+void RangeSet::ToRuns()
+{
+    m_runs = Ranges();
+    m_bits.clear();
+    m_origin = 0;
+    m_dense = false;
+}
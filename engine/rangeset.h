@@ -0,0 +1,58 @@
+#ifndef RANGESET_H
+#define RANGESET_H
+
+#include <QVector>
+#include "rangetypes.h"
+#include "selectionindex.h"
+
+// 刻度集合，支持并、交、差、补
+// 默认保存为排好序、互不相交也不相邻的闭区间，集合运算都是一次线性归并，O(n + m)。
+// 片段很碎（平均每个片段连同间隔不到128个刻度）时自动改为位图保存，两个位图之间按64位字运算
+class RangeSet
+{
+public:
+    RangeSet();
+    // 输入可以无序、重叠，构造时排序合并
+    explicit RangeSet(const QVector<TickRange>& ranges);
+    static RangeSet FromRuns(const SelectionIndex::RunMap& runs);
+
+    bool IsEmpty() const;
+    bool IsDense() const;
+    int RunCount() const;
+    // 覆盖的刻度总数
+    qint64 Length() const;
+    bool Contains(qint64 tick) const;
+    QVector<TickRange> Ranges() const;
+
+    RangeSet Union(const RangeSet& other) const;
+    RangeSet Intersection(const RangeSet& other) const;
+    RangeSet Difference(const RangeSet& other) const;
+    // [begin, end]中不属于本集合的部分
+    RangeSet Complement(qint64 begin, qint64 end) const;
+
+    bool operator == (const RangeSet& other) const;
+    bool operator != (const RangeSet& other) const;
+
+private:
+    enum Operation {
+        Operation_Union,
+        Operation_Intersection,
+        Operation_Difference,
+    };
+
+    RangeSet Combine(const RangeSet& other, Operation operation) const;
+    static RangeSet FromSortedRuns(const QVector<TickRange>& runs);
+    static QVector<TickRange> MergeRuns(const QVector<TickRange>& lhs, const QVector<TickRange>& rhs, Operation operation);
+    static RangeSet MergeBits(const RangeSet& lhs, const RangeSet& rhs, Operation operation);
+    void Compact();
+    void ToDense();
+    void ToRuns();
+
+private:
+    QVector<TickRange> m_runs;      // 稀疏保存
+    QVector<quint64> m_bits;        // 位图保存，第i位表示刻度m_origin + i
+    qint64 m_origin;                // 64的倍数
+    bool m_dense;
+};
+
+#endif // RANGESET_H
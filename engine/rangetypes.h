@@ -3,6 +3,7 @@
 
 #include <QTime>
 #include <QVector>
+#include <QMetaType>
 
 typedef struct _tagTimeRange
 {
@@ -50,6 +51,100 @@ typedef struct _tagRowTimeRange : public TimeRange
     }
 } RowTimeRange, *PRowTimeRange;
 
+// 以整数刻度（毫秒或帧）表示的时间范围，闭区间，不受QTime的24小时限制
+typedef struct _tagTickRange
+{
+    qint64 begin;
+    qint64 end;
+
+    _tagTickRange()
+    {
+        begin = end = 0;
+    }
+    _tagTickRange(qint64 tickBegin, qint64 tickEnd)
+    {
+        begin = tickBegin;
+        end = tickEnd;
+    }
+} TickRange, *PTickRange;
+
+typedef struct _tagRowTickRange : public TickRange
+{
+    int row;
+
+    _tagRowTickRange()
+    {
+        row = -1;
+    }
+    _tagRowTickRange(int tickRow, qint64 tickBegin, qint64 tickEnd)
+        : TickRange(tickBegin, tickEnd)
+    {
+        row = tickRow;
+    }
+} RowTickRange, *PRowTickRange;
+
+// 刻度和像素之间的换算
+// 换算直接用总像素数和总刻度数做整数乘除，误差不超过半个像素，不随跨度和缩放累积；
+// 两个定点比例只用于选择缩放层级、吸附容差等估算
+typedef struct _tagTimeScale
+{
+    enum { FractionBits = 24 };
+
+    qint64 pixels;          // 时间轴总宽度
+    qint64 ticks;           // 时间轴总刻度数
+    qint64 pixelsPerTick;   // 定点数，FractionBits位小数，近似值
+    qint64 ticksPerPixel;   // 定点数，FractionBits位小数，近似值
+
+    _tagTimeScale()
+    {
+        pixels = ticks = pixelsPerTick = ticksPerPixel = 0;
+    }
+    void Setup(qint64 totalPixels, qint64 totalTicks)
+    {
+        if (totalPixels > 0 && totalTicks > 0)
+        {
+            pixels = totalPixels;
+            ticks = totalTicks;
+            pixelsPerTick = ((pixels << FractionBits) + ticks/2) / ticks;
+            ticksPerPixel = ((ticks << FractionBits) + pixels/2) / pixels;
+        }
+        else
+        {
+            pixels = ticks = pixelsPerTick = ticksPerPixel = 0;
+        }
+    }
+    bool IsValid() const
+    {
+        return pixels > 0 && ticks > 0;
+    }
+    // 先拆出整段再乘余数，中间结果不超过pixels * ticks
+    int ToPixel(qint64 tick) const
+    {
+        return static_cast<int>(Scale(tick, pixels, ticks, ticks / 2));
+    }
+    qint64 ToTick(int pixel) const
+    {
+        return Scale(pixel, ticks, pixels, 0);
+    }
+    // value * numerator / denominator，加上bias后向下取整
+    static qint64 Scale(qint64 value, qint64 numerator, qint64 denominator, qint64 bias)
+    {
+        if (denominator <= 0)
+        {
+            return 0;
+        }
+        qint64 quotient = value / denominator;
+        qint64 remainder = value % denominator;
+        if (remainder < 0)
+        {
+            remainder += denominator;
+            --quotient;
+        }
+        qint64 scaled = remainder * numerator + bias;
+        return quotient * numerator + scaled / denominator;
+    }
+} TimeScale, *PTimeScale;
+
 typedef struct _tagPixelRange {
     int start;
     int end;
@@ -177,4 +272,47 @@ typedef struct _tagRowPixelRange : public PixelRange
     }
 } RowPixelRange, *PRowPixelRange;
 
+// 某行上的一段闭区间[start, end]，单位由SelectionIndex的使用者决定
+typedef struct _tagRowSpan
+{
+    int row;
+    qint64 start;
+    qint64 end;
+
+    _tagRowSpan()
+    {
+        row = -1;
+        start = end = -1;
+    }
+    _tagRowSpan(int spanRow, qint64 spanStart, qint64 spanEnd)
+    {
+        row = spanRow;
+        start = spanStart;
+        end = spanEnd;
+    }
+} RowSpan, *PRowSpan;
+
+// 一次编辑造成的变化：新增的片段和被移除的片段（可能涉及多行）
+typedef struct _tagSelectionDelta
+{
+    QVector<RowSpan> added;
+    QVector<RowSpan> removed;
+
+    bool IsEmpty() const
+    {
+        return added.isEmpty() && removed.isEmpty();
+    }
+    // 反向变化，用于撤销
+    _tagSelectionDelta Inverted() const
+    {
+        _tagSelectionDelta inverted;
+        inverted.added = removed;
+        inverted.removed = added;
+        return inverted;
+    }
+} SelectionDelta, *PSelectionDelta;
+
+Q_DECLARE_METATYPE(SelectionDelta)
+Q_DECLARE_METATYPE(RowTimeRange)
+
 #endif // RANGETYPES_H
@@ -0,0 +1,307 @@
+#include "selectionengine.h"
+#include "tracer.h"
+
+#include <algorithm>
+
+SelectionEngine::SelectionEngine()
+    : m_ticksPerSecond(1000)
+    , m_snapshot(0)
+    , m_rowTicksRevision(0)
+    , m_rowTimesRevision(0)
+    , m_rowTimesBase(0)
+{
+
+}
+
+void SelectionEngine::SetTimeBase(int ticksPerSecond)
+{
+    if (ticksPerSecond > 0)
+    {
+        m_ticksPerSecond = ticksPerSecond;
+    }
+}
+
+int SelectionEngine::TicksPerSecond() const
+{
+    return m_ticksPerSecond;
+}
+
+qint64 SelectionEngine::ToTick(const QTime& time) const
+{
+    return static_cast<qint64>(QTime(0, 0).msecsTo(time)) * m_ticksPerSecond / 1000;
+}
+
+QTime SelectionEngine::ToTime(qint64 tick) const
+{
+    return QTime(0, 0).addMSecs(static_cast<int>(tick * 1000 / m_ticksPerSecond));
+}
+
+void SelectionEngine::Reset(int rowCount)
+{
+    // 日志中记下清空，重放时才能得到同样的结果
+    if (m_journal.IsOpen())
+    {
+        SelectionDelta delta;
+        QVector<RowTickRange> runs = GetRowTicks();
+        for (int i = 0; i < runs.size(); ++i)
+        {
+            delta.removed.push_back(RowSpan(runs[i].row, runs[i].begin, runs[i].end));
+        }
+        m_journal.Append(delta);
+    }
+    m_selections.Reset(rowCount);
+    m_history.Clear();
+}
+
+const SelectionIndex& SelectionEngine::Selections() const
+{
+    return m_selections;
+}
+
+SelectionDelta SelectionEngine::Add(int row, qint64 start, qint64 end, SelectionIndex::ConflictPolicy policy)
+{
+    VMERGE_TRACE_SCOPE("edit.add");
+    SelectionDelta delta = m_selections.Add(row, start, end, policy);
+    m_history.Push(delta);
+    Record(delta);
+    return delta;
+}
+
+SelectionDelta SelectionEngine::Subtract(int row, qint64 start, qint64 end)
+{
+    VMERGE_TRACE_SCOPE("edit.subtract");
+    SelectionDelta delta = m_selections.Subtract(row, start, end);
+    m_history.Push(delta);
+    Record(delta);
+    return delta;
+}
+
+// 批量导入只做一次排序和扫描，结果作为一步撤销记录
+SelectionDelta SelectionEngine::ApplySelections(const QVector<RowTickRange>& ranges, SelectionIndex::ConflictPolicy policy)
+{
+    VMERGE_TRACE_SCOPE("edit.apply");
+    QVector<RowSpan> spans;
+    spans.reserve(ranges.size());
+    for (int i = 0; i < ranges.size(); ++i)
+    {
+        spans.push_back(RowSpan(ranges[i].row, ranges[i].begin, ranges[i].end));
+    }
+    SelectionDelta delta = m_selections.Merge(spans, policy);
+    m_history.Push(delta);
+    Record(delta);
+    return delta;
+}
+
+SelectionDelta SelectionEngine::ApplySelections(const QVector<RowTimeRange>& ranges, SelectionIndex::ConflictPolicy policy)
+{
+    VMERGE_TRACE_SCOPE("edit.applyTimes");
+    QVector<RowTickRange> tickRanges;
+    tickRanges.reserve(ranges.size());
+    for (int i = 0; i < ranges.size(); ++i)
+    {
+        tickRanges.push_back(RowTickRange(ranges[i].row, ToTick(ranges[i].begin), ToTick(ranges[i].end)));
+    }
+    return ApplySelections(tickRanges, policy);
+}
+
+RangeSet SelectionEngine::RowSet(int row) const
+{
+    return RangeSet::FromRuns(m_selections.Runs(row));
+}
+
+// 删除的和新增的部分互不重叠，两步的变化直接拼成一条记录
+SelectionDelta SelectionEngine::ApplyRowSet(int row, const RangeSet& set, SelectionIndex::ConflictPolicy policy)
+{
+    VMERGE_TRACE_SCOPE("edit.applySet");
+    SelectionDelta delta;
+    if (row < 0 || row >= m_selections.RowCount())
+    {
+        return delta;
+    }
+    RangeSet current = RowSet(row);
+    QVector<TickRange> removed = current.Difference(set).Ranges();
+    QVector<TickRange> added = set.Difference(current).Ranges();
+    for (int i = 0; i < removed.size(); ++i)
+    {
+        SelectionDelta part = m_selections.Subtract(row, removed[i].begin, removed[i].end);
+        delta.added += part.added;
+        delta.removed += part.removed;
+    }
+    if (!added.isEmpty())
+    {
+        QVector<RowSpan> spans;
+        spans.reserve(added.size());
+        for (int i = 0; i < added.size(); ++i)
+        {
+            spans.push_back(RowSpan(row, added[i].begin, added[i].end));
+        }
+        SelectionDelta part = m_selections.Merge(spans, policy);
+        delta.added += part.added;
+        delta.removed += part.removed;
+    }
+    m_history.Push(delta);
+    Record(delta);
+    return delta;
+}
+
+// 撤销和重做只应用记录下来的变化，代价和变化大小成正比
+SelectionDelta SelectionEngine::Undo()
+{
+    VMERGE_TRACE_SCOPE("edit.undo");
+    if (!m_history.CanUndo())
+    {
+        return SelectionDelta();
+    }
+    SelectionDelta delta = m_history.TakeUndo().Inverted();
+    m_selections.Apply(delta);
+    Record(delta);
+    return delta;
+}
+
+SelectionDelta SelectionEngine::Redo()
+{
+    VMERGE_TRACE_SCOPE("edit.redo");
+    if (!m_history.CanRedo())
+    {
+        return SelectionDelta();
+    }
+    SelectionDelta delta = m_history.TakeRedo();
+    m_selections.Apply(delta);
+    Record(delta);
+    return delta;
+}
+
+bool SelectionEngine::CanUndo() const
+{
+    return m_history.CanUndo();
+}
+
+bool SelectionEngine::CanRedo() const
+{
+    return m_history.CanRedo();
+}
+
+void SelectionEngine::SetHistoryBudget(qint64 bytes)
+{
+    m_history.SetBudget(bytes);
+}
+
+QVector<QVector<TimeRange> > SelectionEngine::GetSelectionTimes() const
+{
+    return Snapshot().GetSelectionTimes();
+}
+
+QVector<QVector<TickRange> > SelectionEngine::GetSelectionTicks() const
+{
+    return Snapshot().GetSelectionTicks();
+}
+
+// 结果和索引的修改计数一起缓存，没有编辑时重复导出只是一次浅拷贝
+QVector<RowTimeRange> SelectionEngine::GetRowTimes() const
+{
+    if (m_rowTimesRevision != m_selections.Revision() || m_rowTimesBase != m_ticksPerSecond)
+    {
+        m_rowTimes = Snapshot().GetRowTimes();
+        m_rowTimesRevision = m_selections.Revision();
+        m_rowTimesBase = m_ticksPerSecond;
+    }
+    return m_rowTimes;
+}
+
+QVector<RowTickRange> SelectionEngine::GetRowTicks() const
+{
+    if (m_rowTicksRevision != m_selections.Revision())
+    {
+        m_rowTicks = Snapshot().GetRowTicks();
+        m_rowTicksRevision = m_selections.Revision();
+    }
+    return m_rowTicks;
+}
+
+void SelectionEngine::ForEachRowTick(const std::function<bool(const RowTickRange&)>& callback) const
+{
+    Snapshot().ForEachRowTick(callback);
+}
+
+void SelectionEngine::ForEachRowTime(const std::function<bool(const RowTimeRange&)>& callback) const
+{
+    Snapshot().ForEachRowTime(callback);
+}
+
+// 只复制隐式共享容器的引用；快照存在期间的编辑只分离被修改的块
+SelectionSnapshot SelectionEngine::Snapshot() const
+{
+    return SelectionSnapshot(m_selections, m_ticksPerSecond);
+}
+
+bool SelectionEngine::Save(const QString& path, qint64 timeSpanTicks, const QStringList& rowLabels, const QStringList& columnLabels)
+{
+    VMERGE_TRACE_SCOPE("project.save");
+    quint64 identity = 0;
+    if (!ProjectFile::Save(path, m_ticksPerSecond, timeSpanTicks, rowLabels, columnLabels, m_selections, &identity))
+    {
+        return false;
+    }
+    m_snapshot = identity;
+    if (m_journal.IsOpen())
+    {
+        m_journal.Reset(m_snapshot);
+    }
+    return true;
+}
+
+// 读入的选择不能撤销
+// 先把快照和日志解码到临时索引，全部成功后才替换当前状态；失败时引擎保持原样
+bool SelectionEngine::Load(const ProjectFile& file, const QString& journalPath)
+{
+    VMERGE_TRACE_SCOPE("project.load");
+    if (!file.IsOpen() || file.TicksPerSecond() <= 0)
+    {
+        return false;
+    }
+    // 从当前索引复制再整体重置，修订号继续递增，旧的缓存不会被误认为有效
+    SelectionIndex selections = m_selections;
+    if (!file.LoadInto(selections))
+    {
+        return false;
+    }
+    if (!journalPath.isEmpty() && QFile::exists(journalPath)
+            && ProjectJournal::Replay(journalPath, file.Identity(), selections) < 0)
+    {
+        return false;
+    }
+    CloseJournal();
+    SetTimeBase(file.TicksPerSecond());
+    m_history.Clear();
+    m_selections = selections;
+    m_snapshot = file.Identity();
+    if (!journalPath.isEmpty())
+    {
+        return OpenJournal(journalPath);
+    }
+    return true;
+}
+
+// 之后的每次编辑都以变化的形式追加到日志；日志记下当前快照的标识
+bool SelectionEngine::OpenJournal(const QString& path)
+{
+    return m_journal.Open(path, m_snapshot);
+}
+
+int SelectionEngine::ReplayJournal(const QString& path)
+{
+    return ProjectJournal::Replay(path, m_snapshot, m_selections);
+}
+
+void SelectionEngine::CloseJournal()
+{
+    m_journal.Close();
+}
+
+void SelectionEngine::Record(const SelectionDelta& delta)
+{
+    if (m_journal.IsOpen())
+    {
+        m_journal.Append(delta);
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef SELECTIONENGINE_H
+#define SELECTIONENGINE_H
+
+#include <QTime>
+#include <QVector>
+#include <functional>
+#include "rangetypes.h"
+#include "selectionindex.h"
+#include "selectionhistory.h"
+#include "rangeset.h"
+#include "selectionsnapshot.h"
+#include "projectfile.h"
+
+// 与界面无关的选择编辑：行间互斥、撤销重做、编辑日志、工程读写和时间换算
+// 只依赖QtCore，控件和命令行工具共用；每次编辑返回造成的变化，由调用者决定如何刷新
+class SelectionEngine
+{
+public:
+    SelectionEngine();
+
+    // 选择以整数刻度保存，默认每秒1000个刻度（毫秒）
+    void SetTimeBase(int ticksPerSecond);
+    int TicksPerSecond() const;
+    qint64 ToTick(const QTime& time) const;
+    QTime ToTime(qint64 tick) const;
+
+    void Reset(int rowCount);
+    const SelectionIndex& Selections() const;
+
+    SelectionDelta Add(int row, qint64 start, qint64 end,
+                       SelectionIndex::ConflictPolicy policy = SelectionIndex::Conflict_KeepExisting);
+    SelectionDelta Subtract(int row, qint64 start, qint64 end);
+    SelectionDelta ApplySelections(const QVector<RowTickRange>& ranges, SelectionIndex::ConflictPolicy policy);
+    SelectionDelta ApplySelections(const QVector<RowTimeRange>& ranges, SelectionIndex::ConflictPolicy policy);
+    // 一行的选择作为集合读出，运算后整体写回；只增删两者的差异，作为一步撤销记录
+    RangeSet RowSet(int row) const;
+    SelectionDelta ApplyRowSet(int row, const RangeSet& set,
+                               SelectionIndex::ConflictPolicy policy = SelectionIndex::Conflict_KeepExisting);
+
+    // 没有可撤销或重做的记录时返回空变化
+    SelectionDelta Undo();
+    SelectionDelta Redo();
+    bool CanUndo() const;
+    bool CanRedo() const;
+    void SetHistoryBudget(qint64 bytes);
+
+    QVector<QVector<TimeRange> > GetSelectionTimes() const;
+    QVector<QVector<TickRange> > GetSelectionTicks() const;
+    // 按时间排序的合并计划，结果缓存到下次编辑为止
+    QVector<RowTimeRange> GetRowTimes() const;
+    QVector<RowTickRange> GetRowTicks() const;
+    // 逐段输出合并计划，不分配整个数组；回调返回false时停止
+    void ForEachRowTick(const std::function<bool(const RowTickRange&)>& callback) const;
+    void ForEachRowTime(const std::function<bool(const RowTimeRange&)>& callback) const;
+    // 当前选择的只读快照，O(1)；交给工作线程导出时不影响继续编辑
+    SelectionSnapshot Snapshot() const;
+
+    // 保存快照后清空已打开的日志；读取时先读快照，再重放日志并继续向它追加
+    bool Save(const QString& path, qint64 timeSpanTicks, const QStringList& rowLabels, const QStringList& columnLabels);
+    bool Load(const ProjectFile& file, const QString& journalPath = QString());
+    bool OpenJournal(const QString& path);
+    // 只读重放日志而不打开它追加，之后的编辑不写入该日志；返回重放的记录数，
+    // 文件无效或不是基于最近读取/保存的快照时返回-1
+    // Load在日志无效时返回false且不改变当前选择
+    int ReplayJournal(const QString& path);
+    void CloseJournal();
+
+private:
+    void Record(const SelectionDelta& delta);
+
+private:
+    SelectionIndex m_selections;
+    SelectionHistory m_history;
+    ProjectJournal m_journal;
+    int m_ticksPerSecond;
+    // 最近读取或保存的快照标识，没有快照时为0
+    quint64 m_snapshot;
+
+    mutable QVector<RowTickRange> m_rowTicks;
+    mutable QVector<RowTimeRange> m_rowTimes;
+    mutable quint64 m_rowTicksRevision;
+    mutable quint64 m_rowTimesRevision;
+    mutable int m_rowTimesBase;
+};
+
+#endif // SELECTIONENGINE_H
@@ -0,0 +1,99 @@
+#include "selectionhistory.h"
+
+SelectionHistory::SelectionHistory(qint64 budgetBytes)
+    : m_budget(budgetBytes)
+    , m_bytes(0)
+{
+
+}
+
+void SelectionHistory::SetBudget(qint64 budgetBytes)
+{
+    m_budget = budgetBytes;
+    Trim();
+}
+
+qint64 SelectionHistory::Budget() const
+{
+    return m_budget;
+}
+
+qint64 SelectionHistory::Bytes() const
+{
+    return m_bytes;
+}
+
+void SelectionHistory::Clear()
+{
+    m_undo.clear();
+    m_redo.clear();
+    m_bytes = 0;
+}
+
+void SelectionHistory::Push(const SelectionDelta& delta)
+{
+    if (delta.IsEmpty())
+    {
+        return;
+    }
+    // 新的编辑使重做记录失效
+    for (int i = 0; i < m_redo.size(); ++i)
+    {
+        m_bytes -= Cost(m_redo[i]);
+    }
+    m_redo.clear();
+
+    m_undo.push_back(delta);
+    m_bytes += Cost(delta);
+    Trim();
+}
+
+bool SelectionHistory::CanUndo() const
+{
+    return !m_undo.isEmpty();
+}
+
+bool SelectionHistory::CanRedo() const
+{
+    return !m_redo.isEmpty();
+}
+
+SelectionDelta SelectionHistory::TakeUndo()
+{
+    if (m_undo.isEmpty())
+    {
+        return SelectionDelta();
+    }
+    SelectionDelta delta = m_undo.takeLast();
+    m_redo.push_back(delta);
+    return delta;
+}
+
+SelectionDelta SelectionHistory::TakeRedo()
+{
+    if (m_redo.isEmpty())
+    {
+        return SelectionDelta();
+    }
+    SelectionDelta delta = m_redo.takeLast();
+    m_undo.push_back(delta);
+    return delta;
+}
+
+qint64 SelectionHistory::Cost(const SelectionDelta& delta)
+{
+    return sizeof(SelectionDelta) + (delta.added.size() + delta.removed.size()) * sizeof(RowSpan);
+}
+
+// 先丢弃最早的撤销记录，仍然超出时再丢弃最远的重做记录
+void SelectionHistory::Trim()
+{
+    while (m_bytes > m_budget && !m_undo.isEmpty())
+    {
+        m_bytes -= Cost(m_undo.takeFirst());
+    }
+    while (m_bytes > m_budget && !m_redo.isEmpty())
+    {
+        m_bytes -= Cost(m_redo.takeFirst());
+    }
+}
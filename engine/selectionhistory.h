@@ -0,0 +1,39 @@
+#ifndef SELECTIONHISTORY_H
+#define SELECTIONHISTORY_H
+
+#include <QList>
+#include "rangetypes.h"
+
+// 选择编辑的撤销/重做记录
+// 每次编辑只保存它造成的变化（SelectionDelta），不保存整份选择，
+// 总占用超过预算时丢弃最早的记录
+class SelectionHistory
+{
+public:
+    explicit SelectionHistory(qint64 budgetBytes = 16*1024*1024);
+
+    void SetBudget(qint64 budgetBytes);
+    qint64 Budget() const;
+    qint64 Bytes() const;
+    void Clear();
+
+    void Push(const SelectionDelta& delta);
+    bool CanUndo() const;
+    bool CanRedo() const;
+    // 取出要撤销的变化，调用者负责应用它的反向变化
+    SelectionDelta TakeUndo();
+    // 取出要重做的变化，调用者负责原样应用
+    SelectionDelta TakeRedo();
+
+private:
+    static qint64 Cost(const SelectionDelta& delta);
+    void Trim();
+
+private:
+    QList<SelectionDelta> m_undo;
+    QList<SelectionDelta> m_redo;
+    qint64 m_budget;
+    qint64 m_bytes;
+};
+
+#endif // SELECTIONHISTORY_H
@@ -0,0 +1,406 @@
+#include "selectionindex.h"
+
+#include <algorithm>
+#include <queue>
+
+SelectionIndex::SelectionIndex()
+    : m_revision(1)
+{
+
+}
+
+void SelectionIndex::Reset(int rowCount)
+{
+    m_rows.clear();
+    m_rows.resize(rowCount);
+    m_coverage.clear();
+    ++m_revision;
+}
+
+int SelectionIndex::RowCount() const
+{
+    return m_rows.size();
+}
+
+int SelectionIndex::RunCount() const
+{
+    return m_coverage.size();
+}
+
+quint64 SelectionIndex::Revision() const
+{
+    return m_revision;
+}
+
+const SelectionIndex::RunMap& SelectionIndex::Runs(int row) const
+{
+    static const RunMap empty;
+    if (row < 0 || row >= m_rows.size())
+    {
+        return empty;
+    }
+    return m_rows[row];
+}
+
+int SelectionIndex::OwnerAt(qint64 pos) const
+{
+    CoverageMap::const_iterator it = FirstCoverageAfter(pos);
+    if (it != m_coverage.constEnd() && it.key() <= pos)
+    {
+        return it.value().row;
+    }
+    return -1;
+}
+
+SelectionIndex::OrderedIterator SelectionIndex::OrderedBegin(qint64 from) const
+{
+    return OrderedIterator(FirstCoverageAfter(from));
+}
+
+SelectionIndex::OrderedIterator SelectionIndex::OrderedEnd() const
+{
+    return OrderedIterator(m_coverage.constEnd());
+}
+
+// 边界按位置递增排列：起点、终点+1、下一个起点……
+// 第一个终点+1 >= pos的片段给出pos之后最近的边界，它本身或前一个片段给出pos之前最近的边界
+bool SelectionIndex::NearestEdge(qint64 pos, qint64& edge) const
+{
+    bool found = false;
+    CoverageMap::const_iterator it = FirstCoverageAfter(pos - 1);
+    if (it != m_coverage.constEnd())
+    {
+        edge = it.key() >= pos ? it.key() : it.value().end + 1;
+        found = true;
+        if (it.key() < pos && pos - it.key() < edge - pos)
+        {
+            edge = it.key();
+        }
+    }
+    if (it != m_coverage.constBegin())
+    {
+        qint64 before = (it - 1).value().end + 1;
+        if (!found || pos - before < edge - pos)
+        {
+            edge = before;
+            found = true;
+        }
+    }
+    return found;
+}
+
+SelectionIndex::RunMap::const_iterator SelectionIndex::FirstRunAfter(const RunMap& runs, qint64 pos)
+{
+    RunMap::const_iterator it = runs.upperBound(pos);
+    if (it != runs.constBegin())
+    {
+        RunMap::const_iterator prev = it - 1;
+        if (prev.value() >= pos)
+        {
+            return prev;
+        }
+    }
+    return it;
+}
+
+SelectionDelta SelectionIndex::Add(int row, qint64 start, qint64 end, ConflictPolicy policy)
+{
+    SelectionDelta delta;
+    if (row < 0 || row >= m_rows.size())
+    {
+        return delta;
+    }
+    if (start > end)
+    {
+        std::swap(start, end);
+    }
+    AddSpan(row, start, end, policy, &delta);
+    return delta;
+}
+
+SelectionDelta SelectionIndex::Subtract(int row, qint64 start, qint64 end)
+{
+    SelectionDelta delta;
+    if (row < 0 || row >= m_rows.size())
+    {
+        return delta;
+    }
+    if (start > end)
+    {
+        std::swap(start, end);
+    }
+    EraseSpan(row, start, end, &delta.removed);
+    return delta;
+}
+
+// 变化来自之前的编辑，撤销时先移除添加的部分才能放回被移除的部分，因此顺序固定
+void SelectionIndex::Apply(const SelectionDelta& delta)
+{
+    for (int i = 0; i < delta.removed.size(); ++i)
+    {
+        const RowSpan& span = delta.removed[i];
+        if (span.row >= 0 && span.row < m_rows.size())
+        {
+            EraseSpan(span.row, span.start, span.end, nullptr);
+        }
+    }
+    for (int i = 0; i < delta.added.size(); ++i)
+    {
+        const RowSpan& span = delta.added[i];
+        if (span.row >= 0 && span.row < m_rows.size())
+        {
+            InsertSpan(span.row, span.start, span.end, nullptr);
+        }
+    }
+}
+
+SelectionDelta SelectionIndex::Merge(const QVector<RowSpan>& spans, ConflictPolicy policy)
+{
+    SelectionDelta delta;
+
+    // 输入范围之间的优先级：数值越大越优先
+    QVector<RowSpan> candidates;
+    QVector<qint64> priorities;
+    candidates.reserve(spans.size());
+    priorities.reserve(spans.size());
+    for (int i = 0; i < spans.size(); ++i)
+    {
+        RowSpan span = spans[i];
+        if (span.row < 0 || span.row >= m_rows.size())
+        {
+            continue;
+        }
+        if (span.start > span.end)
+        {
+            std::swap(span.start, span.end);
+        }
+        candidates.push_back(span);
+        switch (policy)
+        {
+        case Conflict_KeepExisting:
+            priorities.push_back(-i);
+            break;
+        case Conflict_Overwrite:
+            priorities.push_back(i);
+            break;
+        case Conflict_LowerRow:
+            priorities.push_back(-static_cast<qint64>(span.row) * (Q_INT64_C(1) << 32) - i);
+            break;
+        }
+    }
+    if (candidates.isEmpty())
+    {
+        return delta;
+    }
+
+    QVector<int> order(candidates.size());
+    QVector<qint64> points;
+    points.reserve(candidates.size() * 2);
+    for (int i = 0; i < candidates.size(); ++i)
+    {
+        order[i] = i;
+        points.push_back(candidates[i].start);
+        points.push_back(candidates[i].end + 1);
+    }
+    std::sort(order.begin(), order.end(), [&candidates](int lhs, int rhs) {
+        return candidates[lhs].start < candidates[rhs].start;
+    });
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+
+    // 扫描线：相邻两个端点之间的区间归当前覆盖它的最优先范围，过期的范围延迟出堆
+    std::priority_queue<std::pair<qint64, int> > active;
+    QVector<RowSpan> pieces;
+    int next = 0;
+    for (int i = 0; i + 1 < points.size(); ++i)
+    {
+        qint64 pos = points[i];
+        while (next < order.size() && candidates[order[next]].start <= pos)
+        {
+            active.push(std::make_pair(priorities[order[next]], order[next]));
+            ++next;
+        }
+        while (!active.empty() && candidates[active.top().second].end < pos)
+        {
+            active.pop();
+        }
+        if (active.empty())
+        {
+            continue;
+        }
+        int row = candidates[active.top().second].row;
+        qint64 end = points[i + 1] - 1;
+        if (!pieces.isEmpty() && pieces.back().row == row && pieces.back().end + 1 == pos)
+        {
+            pieces.back().end = end;
+        }
+        else
+        {
+            pieces.push_back(RowSpan(row, pos, end));
+        }
+    }
+
+    // 输入之间已经互不重叠，逐段按策略和已有选择合并
+    for (int i = 0; i < pieces.size(); ++i)
+    {
+        AddSpan(pieces[i].row, pieces[i].start, pieces[i].end, policy, &delta);
+    }
+    return delta;
+}
+
+// 按策略把[start, end]并入本行：让步的其他行片段挡住新范围，不让步的被裁剪
+void SelectionIndex::AddSpan(int row, qint64 start, qint64 end, ConflictPolicy policy, SelectionDelta* delta)
+{
+    QVector<RowSpan> freeSpans;
+    QVector<RowSpan> trimSpans;
+    qint64 cursor = start;
+    for (CoverageMap::const_iterator it = FirstCoverageAfter(start);
+         it != m_coverage.constEnd() && it.key() <= end; ++it)
+    {
+        const Owner& owner = it.value();
+        if (owner.row == row)
+        {
+            continue;
+        }
+        bool keep = policy == Conflict_KeepExisting || (policy == Conflict_LowerRow && owner.row < row);
+        if (!keep)
+        {
+            trimSpans.push_back(RowSpan(owner.row, qMax(start, it.key()), qMin(end, owner.end)));
+            continue;
+        }
+        if (it.key() > cursor)
+        {
+            freeSpans.push_back(RowSpan(row, cursor, it.key() - 1));
+        }
+        cursor = qMax(cursor, owner.end + 1);
+    }
+    if (cursor <= end)
+    {
+        freeSpans.push_back(RowSpan(row, cursor, end));
+    }
+
+    for (int i = 0; i < trimSpans.size(); ++i)
+    {
+        EraseSpan(trimSpans[i].row, trimSpans[i].start, trimSpans[i].end, &delta->removed);
+    }
+    for (int i = 0; i < freeSpans.size(); ++i)
+    {
+        InsertSpan(row, freeSpans[i].start, freeSpans[i].end, &delta->added);
+    }
+}
+
+// 返回第一个终点 >= pos 的覆盖片段
+SelectionIndex::CoverageMap::const_iterator SelectionIndex::FirstCoverageAfter(qint64 pos) const
+{
+    CoverageMap::const_iterator it = m_coverage.upperBound(pos);
+    if (it != m_coverage.constBegin())
+    {
+        CoverageMap::const_iterator prev = it - 1;
+        if (prev.value().end >= pos)
+        {
+            return prev;
+        }
+    }
+    return it;
+}
+
+// 把[start, end]并入本行，调用者保证这段范围没有被其他行占用
+// 与之重叠或相邻的本行片段会被合并成一段，真正新增的部分记录到added
+// 本行已有片段包含整段范围时什么也不改，修订号不变，缓存和快照共享的块都保持有效
+void SelectionIndex::InsertSpan(int row, qint64 start, qint64 end, QVector<RowSpan>* added)
+{
+    const RunMap& owned = m_rows.at(row);
+    RunMap::const_iterator found = owned.upperBound(start);
+    if (found != owned.constBegin() && (found - 1).value() >= end)
+    {
+        return;
+    }
+
+    RunMap& runs = m_rows[row];
+    qint64 mergedStart = start;
+    qint64 mergedEnd = end;
+    qint64 cursor = start;
+
+    RunMap::iterator it = runs.upperBound(start);
+    if (it != runs.begin())
+    {
+        RunMap::iterator prev = it - 1;
+        if (prev.value() >= start - 1)
+        {
+            it = prev;
+        }
+    }
+    while (it != runs.end() && it.key() <= end + 1)
+    {
+        if (it.key() > cursor && added)
+        {
+            added->push_back(RowSpan(row, cursor, it.key() - 1));
+        }
+        cursor = qMax(cursor, it.value() + 1);
+        mergedStart = qMin(mergedStart, it.key());
+        mergedEnd = qMax(mergedEnd, it.value());
+        m_coverage.remove(it.key());
+        it = runs.erase(it);
+    }
+    if (cursor <= end && added)
+    {
+        added->push_back(RowSpan(row, cursor, end));
+    }
+    InsertRun(row, mergedStart, mergedEnd);
+}
+
+// 从本行挖掉[start, end]，被挖掉的部分记录到removed
+void SelectionIndex::EraseSpan(int row, qint64 start, qint64 end, QVector<RowSpan>* removed)
+{
+    RunMap& runs = m_rows[row];
+    RowSpan left, right;
+
+    RunMap::iterator it = runs.upperBound(start);
+    if (it != runs.begin())
+    {
+        RunMap::iterator prev = it - 1;
+        if (prev.value() >= start)
+        {
+            it = prev;
+        }
+    }
+    while (it != runs.end() && it.key() <= end)
+    {
+        qint64 runStart = it.key();
+        qint64 runEnd = it.value();
+        if (removed)
+        {
+            removed->push_back(RowSpan(row, qMax(runStart, start), qMin(runEnd, end)));
+        }
+        // 首尾片段可能只被挖掉一部分，剩余部分在循环结束后放回
+        if (runStart < start)
+        {
+            left = RowSpan(row, runStart, start - 1);
+        }
+        if (runEnd > end)
+        {
+            right = RowSpan(row, end + 1, runEnd);
+        }
+        m_coverage.remove(runStart);
+        it = runs.erase(it);
+        ++m_revision;
+    }
+    if (left.row != -1)
+    {
+        InsertRun(row, left.start, left.end);
+    }
+    if (right.row != -1)
+    {
+        InsertRun(row, right.start, right.end);
+    }
+}
+
+void SelectionIndex::InsertRun(int row, qint64 start, qint64 end)
+{
+    Owner owner;
+    owner.end = end;
+    owner.row = row;
+    m_rows[row].insert(start, end);
+    m_coverage.insert(start, owner);
+    ++m_revision;
+}
@@ -0,0 +1,94 @@
+#ifndef SELECTIONINDEX_H
+#define SELECTIONINDEX_H
+
+#include <QMetaType>
+#include <QVector>
+#include <limits>
+#include "rangetypes.h"
+#include "chunkedmap.h"
+
+// 多行选择的有序区间索引
+// 每行保存按起点排序的不相交片段，另有一张全局覆盖表记录每个片段属于哪一行。
+// 由于各行选择互斥，全局覆盖表中的片段也互不相交，因此增删一个范围、
+// 检查它和其他行的冲突都只需 O(log n + k)，k为涉及的片段数。
+// 两种表都是分块映射，复制索引是O(1)，复制之后的编辑只分离它碰到的块
+class SelectionIndex
+{
+    struct Owner
+    {
+        qint64 end;
+        int row;
+    };
+    typedef ChunkedMap<qint64, Owner> CoverageMap;
+
+public:
+    typedef ChunkedMap<qint64, qint64> RunMap;  // 起点 -> 终点（闭区间）
+
+    // 按起点顺序遍历所有行的片段
+    // 各行互斥，全局覆盖表本身就是所有行归并后的顺序，遍历不需要排序或堆
+    class OrderedIterator
+    {
+    public:
+        OrderedIterator() {}
+        RowSpan operator*() const { return RowSpan(m_it.value().row, m_it.key(), m_it.value().end); }
+        OrderedIterator& operator++() { ++m_it; return *this; }
+        bool operator==(const OrderedIterator& other) const { return m_it == other.m_it; }
+        bool operator!=(const OrderedIterator& other) const { return m_it != other.m_it; }
+
+    private:
+        friend class SelectionIndex;
+        explicit OrderedIterator(CoverageMap::const_iterator it) : m_it(it) {}
+        CoverageMap::const_iterator m_it;
+    };
+
+    // 新范围和其他行已有选择冲突时谁优先
+    enum ConflictPolicy {
+        Conflict_KeepExisting,  // 已有选择优先；批量导入时先出现的范围优先
+        Conflict_Overwrite,     // 新范围优先并裁剪其他行；批量导入时后出现的范围优先
+        Conflict_LowerRow,      // 行号小的优先，不论新旧
+    };
+
+    SelectionIndex();
+
+    void Reset(int rowCount);
+    int RowCount() const;
+    int RunCount() const;
+    // 每次修改后递增，用于判断缓存的导出结果是否过期；从1开始，0可作为缓存无效的标记
+    quint64 Revision() const;
+
+    const RunMap& Runs(int row) const;
+    int OwnerAt(qint64 pos) const;
+    // 从第一个终点 >= from 的片段开始
+    OrderedIterator OrderedBegin(qint64 from = std::numeric_limits<qint64>::min()) const;
+    OrderedIterator OrderedEnd() const;
+    // 离pos最近的片段边界（起点或终点的下一个刻度），所有行一起查找；没有任何片段时返回false
+    bool NearestEdge(qint64 pos, qint64& edge) const;
+
+    // 二分查找第一个终点 >= pos 的片段
+    static RunMap::const_iterator FirstRunAfter(const RunMap& runs, qint64 pos);
+
+    // 增加选择：默认已被其他行选中的部分保持不变，只把剩余部分并入目标行
+    SelectionDelta Add(int row, qint64 start, qint64 end, ConflictPolicy policy = Conflict_KeepExisting);
+    // 删除选择：只影响目标行
+    SelectionDelta Subtract(int row, qint64 start, qint64 end);
+    // 原样应用一次变化（先移除再添加），不做互斥检查，用于撤销和重做
+    void Apply(const SelectionDelta& delta);
+    // 批量增加选择：排序后一次扫描解决输入之间的行间冲突并合并相邻片段，再按策略并入
+    SelectionDelta Merge(const QVector<RowSpan>& spans, ConflictPolicy policy);
+
+private:
+    CoverageMap::const_iterator FirstCoverageAfter(qint64 pos) const;
+    void AddSpan(int row, qint64 start, qint64 end, ConflictPolicy policy, SelectionDelta* delta);
+    void InsertSpan(int row, qint64 start, qint64 end, QVector<RowSpan>* added);
+    void EraseSpan(int row, qint64 start, qint64 end, QVector<RowSpan>* removed);
+    void InsertRun(int row, qint64 start, qint64 end);
+
+private:
+    QVector<RunMap> m_rows;
+    CoverageMap m_coverage;
+    quint64 m_revision;
+};
+
+Q_DECLARE_METATYPE(SelectionIndex::RunMap)
+
+#endif // SELECTIONINDEX_H
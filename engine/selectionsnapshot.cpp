@@ -0,0 +1,125 @@
+#include "selectionsnapshot.h"
+#include "tracer.h"
+
+SelectionSnapshot::SelectionSnapshot()
+    : m_ticksPerSecond(1000)
+{
+
+}
+
+SelectionSnapshot::SelectionSnapshot(const SelectionIndex& selections, int ticksPerSecond)
+    : m_selections(selections)
+    , m_ticksPerSecond(ticksPerSecond)
+{
+
+}
+
+quint64 SelectionSnapshot::Revision() const
+{
+    return m_selections.Revision();
+}
+
+int SelectionSnapshot::TicksPerSecond() const
+{
+    return m_ticksPerSecond;
+}
+
+QTime SelectionSnapshot::ToTime(qint64 tick) const
+{
+    return QTime(0, 0).addMSecs(static_cast<int>(tick * 1000 / m_ticksPerSecond));
+}
+
+const SelectionIndex& SelectionSnapshot::Selections() const
+{
+    return m_selections;
+}
+
+QVector<QVector<TimeRange> > SelectionSnapshot::GetSelectionTimes() const
+{
+    VMERGE_TRACE_SCOPE("export.selectionTimes");
+    QVector<QVector<TimeRange> > timeRangeVector;
+    timeRangeVector.reserve(m_selections.RowCount());
+    for (int i = 0; i < m_selections.RowCount(); ++i)
+    {
+        timeRangeVector.push_back(QVector<TimeRange>());
+        QVector<TimeRange> & rowTimeRange = timeRangeVector.back();
+        const SelectionIndex::RunMap& runs = m_selections.Runs(i);
+        rowTimeRange.reserve(runs.size());
+        for (SelectionIndex::RunMap::const_iterator it = runs.constBegin(); it != runs.constEnd(); ++it)
+        {
+            rowTimeRange.push_back(TimeRange());
+            TimeRange & timeRange = rowTimeRange.back();
+            timeRange.begin = ToTime(it.key());
+            timeRange.end = ToTime(it.value());
+        }
+    }
+    return timeRangeVector;
+}
+
+// 直接导出保存的刻度，不做任何换算
+QVector<QVector<TickRange> > SelectionSnapshot::GetSelectionTicks() const
+{
+    VMERGE_TRACE_SCOPE("export.selectionTicks");
+    QVector<QVector<TickRange> > tickRangeVector;
+    tickRangeVector.reserve(m_selections.RowCount());
+    for (int i = 0; i < m_selections.RowCount(); ++i)
+    {
+        tickRangeVector.push_back(QVector<TickRange>());
+        QVector<TickRange> & rowTickRange = tickRangeVector.back();
+        const SelectionIndex::RunMap& runs = m_selections.Runs(i);
+        rowTickRange.reserve(runs.size());
+        for (SelectionIndex::RunMap::const_iterator it = runs.constBegin(); it != runs.constEnd(); ++it)
+        {
+            rowTickRange.push_back(TickRange(it.key(), it.value()));
+        }
+    }
+    return tickRangeVector;
+}
+
+// 各行互斥，按全局覆盖表的顺序遍历就是合并后的顺序，不需要排序
+QVector<RowTimeRange> SelectionSnapshot::GetRowTimes() const
+{
+    VMERGE_TRACE_SCOPE("export.rowTimes");
+    QVector<RowTimeRange> rowTimes;
+    rowTimes.reserve(m_selections.RunCount());
+    ForEachRowTime([&rowTimes](const RowTimeRange& range) { rowTimes.push_back(range); return true; });
+    return rowTimes;
+}
+
+QVector<RowTickRange> SelectionSnapshot::GetRowTicks() const
+{
+    VMERGE_TRACE_SCOPE("export.rowTicks");
+    QVector<RowTickRange> rowTicks;
+    rowTicks.reserve(m_selections.RunCount());
+    ForEachRowTick([&rowTicks](const RowTickRange& range) { rowTicks.push_back(range); return true; });
+    return rowTicks;
+}
+
+void SelectionSnapshot::ForEachRowTick(const std::function<bool(const RowTickRange&)>& callback) const
+{
+    VMERGE_TRACE_SCOPE("export.forEachRowTick");
+    for (SelectionIndex::OrderedIterator it = m_selections.OrderedBegin(); it != m_selections.OrderedEnd(); ++it)
+    {
+        RowSpan span = *it;
+        if (!callback(RowTickRange(span.row, span.start, span.end)))
+        {
+            return;
+        }
+    }
+}
+
+void SelectionSnapshot::ForEachRowTime(const std::function<bool(const RowTimeRange&)>& callback) const
+{
+    RowTimeRange range;
+    for (SelectionIndex::OrderedIterator it = m_selections.OrderedBegin(); it != m_selections.OrderedEnd(); ++it)
+    {
+        RowSpan span = *it;
+        range.row = span.row;
+        range.begin = ToTime(span.start);
+        range.end = ToTime(span.end);
+        if (!callback(range))
+        {
+            return;
+        }
+    }
+}
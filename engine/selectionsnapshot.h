@@ -0,0 +1,41 @@
+#ifndef SELECTIONSNAPSHOT_H
+#define SELECTIONSNAPSHOT_H
+
+#include <QMetaType>
+#include <QTime>
+#include <QVector>
+#include <functional>
+#include "rangetypes.h"
+#include "selectionindex.h"
+
+// 某一时刻选择的只读快照
+// SelectionIndex的行表和全局覆盖表都是隐式共享的分块映射（见chunkedmap.h），建立快照只增加引用计数，O(1)。
+// 引擎之后的编辑在写入前只分离它碰到的块，快照看到的内容始终不变，编辑的复制代价和改动的范围有关，与选择总量无关；
+// 快照只读，可以交给工作线程导出合并计划、统计或保存，不需要加锁
+class SelectionSnapshot
+{
+public:
+    SelectionSnapshot();
+    SelectionSnapshot(const SelectionIndex& selections, int ticksPerSecond);
+
+    // 建立快照时索引的修改计数，相同说明内容相同
+    quint64 Revision() const;
+    int TicksPerSecond() const;
+    QTime ToTime(qint64 tick) const;
+    const SelectionIndex& Selections() const;
+
+    QVector<QVector<TimeRange> > GetSelectionTimes() const;
+    QVector<QVector<TickRange> > GetSelectionTicks() const;
+    QVector<RowTimeRange> GetRowTimes() const;
+    QVector<RowTickRange> GetRowTicks() const;
+    void ForEachRowTick(const std::function<bool(const RowTickRange&)>& callback) const;
+    void ForEachRowTime(const std::function<bool(const RowTimeRange&)>& callback) const;
+
+private:
+    SelectionIndex m_selections;
+    int m_ticksPerSecond;
+};
+
+Q_DECLARE_METATYPE(SelectionSnapshot)
+
+#endif // SELECTIONSNAPSHOT_H
@@ -0,0 +1,58 @@
+#include "snapindex.h"
+
+#include <algorithm>
+
+SnapIndex::SnapIndex()
+{
+
+}
+
+void SnapIndex::Reset(int rowCount)
+{
+    m_keyframes.clear();
+    m_keyframes.resize(qMax(0, rowCount));
+}
+
+void SnapIndex::SetKeyframes(int row, const QVector<qint64>& ticks)
+{
+    if (row < 0 || row >= m_keyframes.size())
+    {
+        return;
+    }
+    QVector<qint64> sorted = ticks;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    m_keyframes[row] = sorted;
+}
+
+const QVector<qint64>& SnapIndex::Keyframes(int row) const
+{
+    static const QVector<qint64> empty;
+    return row >= 0 && row < m_keyframes.size() ? m_keyframes[row] : empty;
+}
+
+qint64 SnapIndex::Snap(const SelectionIndex& selections, int row, qint64 pos, qint64 tolerance) const
+{
+    qint64 target = pos;
+    qint64 distance = tolerance + 1;
+
+    const QVector<qint64>& keyframes = Keyframes(row);
+    QVector<qint64>::const_iterator it = std::lower_bound(keyframes.constBegin(), keyframes.constEnd(), pos);
+    if (it != keyframes.constEnd() && *it - pos < distance)
+    {
+        target = *it;
+        distance = *it - pos;
+    }
+    if (it != keyframes.constBegin() && pos - *(it - 1) < distance)
+    {
+        target = *(it - 1);
+        distance = pos - *(it - 1);
+    }
+
+    qint64 edge = 0;
+    if (selections.NearestEdge(pos, edge) && qAbs(edge - pos) < distance)
+    {
+        target = edge;
+    }
+    return target;
+}
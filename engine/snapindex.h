@@ -0,0 +1,28 @@
+#ifndef SNAPINDEX_H
+#define SNAPINDEX_H
+
+#include <QVector>
+#include "selectionindex.h"
+
+// 拖动选择时的吸附目标
+// 每行的关键帧保存为排好序的数组，选择边界直接查SelectionIndex的全局覆盖表，两者都是二分查找，
+// 每次查找 O(log n)，高回报率鼠标下也不会拖慢事件处理
+class SnapIndex
+{
+public:
+    SnapIndex();
+
+    void Reset(int rowCount);
+    // 关键帧刻度不要求有序，保存时排序并去重
+    void SetKeyframes(int row, const QVector<qint64>& ticks);
+    const QVector<qint64>& Keyframes(int row) const;
+
+    // 找离pos最近、距离不超过tolerance的吸附点：row行的关键帧或任意行的选择边界，没有时返回pos
+    // 边界指切点，片段[start, end]的边界为start和end + 1
+    qint64 Snap(const SelectionIndex& selections, int row, qint64 pos, qint64 tolerance) const;
+
+private:
+    QVector<QVector<qint64> > m_keyframes;
+};
+
+#endif // SNAPINDEX_H
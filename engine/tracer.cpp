@@ -0,0 +1,146 @@
+#include "tracer.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSaveFile>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+
+Tracer& Tracer::Instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+qint64 Tracer::Now()
+{
+    static QElapsedTimer clock;
+    static bool started = (clock.start(), true);
+    Q_UNUSED(started);
+    return clock.nsecsElapsed();
+}
+
+Tracer::Tracer()
+    : m_events(new Event[Capacity])
+    , m_next(0)
+{
+    Reset();
+}
+
+Tracer::~Tracer()
+{
+    delete [] m_events;
+}
+
+// 先取得槽位再写内容，最后写序号；读的一方前后两次序号一致才认为记录完整
+void Tracer::Record(const char* name, qint64 start, qint64 duration)
+{
+    quint64 index = m_next.fetchAndAddRelaxed(1);
+    Event& event = m_events[index & (Capacity - 1)];
+    event.sequence.fetchAndStoreOrdered(0);
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    event.thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+    event.sequence.storeRelease(index + 1);
+}
+
+void Tracer::Reset()
+{
+    for (int i = 0; i < Capacity; ++i)
+    {
+        m_events[i].sequence.storeRelease(0);
+    }
+}
+
+QVector<Tracer::Snapshot> Tracer::Events() const
+{
+    QVector<Snapshot> events;
+    for (int i = 0; i < Capacity; ++i)
+    {
+        const Event& event = m_events[i];
+        quint64 sequence = event.sequence.loadAcquire();
+        if (sequence == 0)
+        {
+            continue;
+        }
+        Snapshot snapshot;
+        snapshot.name = event.name;
+        snapshot.start = event.start;
+        snapshot.duration = event.duration;
+        snapshot.thread = event.thread;
+        // 读出内容不能被挪到复查序号之后，否则读到一半被覆盖的记录也能通过复查
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (event.sequence.loadAcquire() == sequence)
+        {
+            events.push_back(snapshot);
+        }
+    }
+    return events;
+}
+
+// 同一个名字在不同编译单元中可能是不同的指针，按内容分组
+QVector<TraceStats> Tracer::Stats(qint64 budget) const
+{
+    QHash<QByteArray, QVector<qint64> > durations;
+    QVector<Snapshot> events = Events();
+    for (int i = 0; i < events.size(); ++i)
+    {
+        durations[QByteArray(events[i].name)].push_back(events[i].duration);
+    }
+
+    QVector<TraceStats> stats;
+    for (QHash<QByteArray, QVector<qint64> >::iterator it = durations.begin(); it != durations.end(); ++it)
+    {
+        QVector<qint64>& values = it.value();
+        std::sort(values.begin(), values.end());
+        TraceStats item;
+        item.name = it.key();
+        item.count = values.size();
+        item.p50 = values[(values.size() - 1) * 50 / 100];
+        item.p99 = values[(values.size() - 1) * 99 / 100];
+        item.max = values.back();
+        item.overBudget = static_cast<int>(values.end() - std::upper_bound(values.begin(), values.end(), budget));
+        stats.push_back(item);
+    }
+    std::sort(stats.begin(), stats.end(), [](const TraceStats& lhs, const TraceStats& rhs) { return lhs.name < rhs.name; });
+    return stats;
+}
+
+// 时间以微秒为单位，每条记录是一个完整事件（ph为X）
+bool Tracer::ExportChromeTrace(const QString& path) const
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QVector<Snapshot> events = Events();
+    std::sort(events.begin(), events.end(), [](const Snapshot& lhs, const Snapshot& rhs) { return lhs.start < rhs.start; });
+    QHash<quint64, int> threads;
+    QByteArray json("{\"traceEvents\":[\n");
+    for (int i = 0; i < events.size(); ++i)
+    {
+        QHash<quint64, int>::const_iterator thread = threads.constFind(events[i].thread);
+        if (thread == threads.constEnd())
+        {
+            thread = threads.insert(events[i].thread, threads.size() + 1);
+        }
+        QByteArray name(events[i].name);
+        name.replace('\\', "\\\\").replace('"', "\\\"");
+        json += "{\"name\":\"" + name + "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + QByteArray::number(thread.value())
+                + ",\"ts\":" + QByteArray::number(events[i].start / 1000.0, 'f', 3)
+                + ",\"dur\":" + QByteArray::number(events[i].duration / 1000.0, 'f', 3) + "}";
+        json += i + 1 < events.size() ? ",\n" : "\n";
+        if (json.size() > 1024*1024)
+        {
+            file.write(json);
+            json.clear();
+        }
+    }
+    json += "]}\n";
+    file.write(json);
+    return file.commit();
+}
@@ -0,0 +1,100 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// 耗时统计
+// 用CONFIG+=vmerge_trace编译时，VMERGE_TRACE_SCOPE在作用域结束时把耗时记入环形缓冲区，
+// 否则宏展开为空，没有任何开销。缓冲区写入无锁，满了覆盖最旧的记录，任意线程都可以记录
+#ifdef VMERGE_TRACE
+#define VMERGE_TRACE_CONCAT2(a, b) a##b
+#define VMERGE_TRACE_CONCAT(a, b) VMERGE_TRACE_CONCAT2(a, b)
+#define VMERGE_TRACE_SCOPE(name) TraceScope VMERGE_TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define VMERGE_TRACE_SCOPE(name)
+#endif
+
+typedef struct _tagTraceStats
+{
+    QByteArray name;
+    int count;
+    qint64 p50;         // 纳秒
+    qint64 p99;
+    qint64 max;
+    int overBudget;     // 超过预算的次数，对绘制来说就是掉帧数
+
+    _tagTraceStats()
+    {
+        count = overBudget = 0;
+        p50 = p99 = max = 0;
+    }
+} TraceStats, *PTraceStats;
+
+class Tracer
+{
+public:
+    enum { Capacity = 65536 };  // 2的幂
+
+    static Tracer& Instance();
+    // 进程内单调时钟，纳秒
+    static qint64 Now();
+
+    // name必须是字符串常量，缓冲区只保存指针
+    void Record(const char* name, qint64 start, qint64 duration);
+    void Reset();
+
+    // 按名称统计缓冲区中的记录
+    QVector<TraceStats> Stats(qint64 budget = 16666667) const;
+    // Chrome trace格式（chrome://tracing、Perfetto可直接打开）
+    bool ExportChromeTrace(const QString& path) const;
+
+private:
+    Tracer();
+    ~Tracer();
+    Q_DISABLE_COPY(Tracer)
+
+    struct Event
+    {
+        QAtomicInteger<quint64> sequence;   // 写入序号+1，0表示空或正在写
+        const char* name;
+        qint64 start;
+        qint64 duration;
+        quint64 thread;
+    };
+    struct Snapshot
+    {
+        const char* name;
+        qint64 start;
+        qint64 duration;
+        quint64 thread;
+    };
+    QVector<Snapshot> Events() const;
+
+private:
+    Event* m_events;
+    QAtomicInteger<quint64> m_next;
+};
+
+// 构造时记下开始时间，析构时记录耗时
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name)
+        : m_name(name)
+        , m_start(Tracer::Now())
+    {}
+    ~TraceScope()
+    {
+        Tracer::Instance().Record(m_name, m_start, Tracer::Now() - m_start);
+    }
+
+private:
+    Q_DISABLE_COPY(TraceScope)
+    const char* m_name;
+    qint64 m_start;
+};
+
+#endif // TRACER_H
@@ -2,43 +2,24 @@
 #
 # Project created by QtCreator 2019-07-13T22:33:02
 #
+# engine      选择引擎静态库，只依赖QtCore
+# widget      RangeTable控件静态库
+# app         演示程序
+# cli         命令行工具，执行选择脚本并输出合并计划
+# benchmarks  性能基准
+#
 #-------------------------------------------------
 
-QT       += core gui
-
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
-
-TARGET = vmerge
-TEMPLATE = app
-
-# The following define makes your compiler emit warnings if you use
-# any feature of Qt which has been marked as deprecated (the exact warnings
-# depend on your compiler). Please consult the documentation of the
-# deprecated API in order to know how to port your code away from it.
-DEFINES += QT_DEPRECATED_WARNINGS
-
-# You can also make your code fail to compile if you use deprecated APIs.
-# In order to do so, uncomment the following line.
-# You can also select to disable deprecated APIs only up to a certain version of Qt.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
-
-CONFIG += c++11
-
-SOURCES += \
-        main.cpp \
-        mainwindow.cpp \
-        rangetable.cpp
-
-HEADERS += \
-        mainwindow.h \
-        rangetable.h \
-        rangetypes.h
-
+TEMPLATE = subdirs
 
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
+SUBDIRS = \
+        engine \
+        widget \
+        app \
+        cli \
+        benchmarks
 
-RESOURCES += \
-    images.qrc
+widget.depends = engine
+app.depends = widget
+cli.depends = engine
+benchmarks.depends = widget
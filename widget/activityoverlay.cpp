@@ -0,0 +1,145 @@
+#include "activityoverlay.h"
+#include "tracer.h"
+
+#include <QRunnable>
+#include <QPainter>
+#include <QLine>
+
+class ActivityBuildTask : public QRunnable
+{
+public:
+    explicit ActivityBuildTask(ActivityOverlay* owner, int row, int generation, const QVector<float>& samples,
+                               qint64 startTick, qint64 ticksPerSample)
+        : m_owner(owner)
+        , m_row(row)
+        , m_generation(generation)
+        , m_samples(samples)
+        , m_startTick(startTick)
+        , m_ticksPerSample(ticksPerSample)
+    {}
+    virtual ~ActivityBuildTask() {}
+
+private:
+    virtual void run()
+    {
+        VMERGE_TRACE_SCOPE("activity.build");
+        ActivityPyramid pyramid;
+        pyramid.Build(m_samples, m_startTick, m_ticksPerSample);
+        QMetaObject::invokeMethod(m_owner, "OnBuilt", Qt::QueuedConnection,
+                                  Q_ARG(int, m_row), Q_ARG(int, m_generation), Q_ARG(ActivityPyramid, pyramid));
+    }
+
+private:
+    ActivityOverlay* m_owner;
+    int m_row;
+    int m_generation;
+    QVector<float> m_samples;
+    qint64 m_startTick;
+    qint64 m_ticksPerSample;
+};
+
+ActivityOverlay::ActivityOverlay(QObject* parent)
+    : QObject(parent)
+    , m_generation(0)
+    , m_seriesCount(0)
+{
+    qRegisterMetaType<ActivityPyramid>();
+    // 建金字塔只是几遍线性扫描，一个线程足够，不和缩略图解码抢线程
+    m_pool.setMaxThreadCount(1);
+}
+
+ActivityOverlay::~ActivityOverlay()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void ActivityOverlay::SetRowCount(int rowCount)
+{
+    ++m_generation;
+    m_pool.clear();
+    m_rows.clear();
+    m_rows.resize(rowCount);
+    m_rowGenerations.fill(m_generation, rowCount);
+    m_seriesCount = 0;
+}
+
+void ActivityOverlay::SetSeries(int row, const QVector<float>& samples, qint64 startTick, qint64 ticksPerSample)
+{
+    if (row < 0 || row >= m_rows.size())
+    {
+        return;
+    }
+    m_rowGenerations[row] = ++m_generation;
+    m_pool.start(new ActivityBuildTask(this, row, m_generation, samples, startTick, ticksPerSample));
+}
+
+void ActivityOverlay::ClearSeries(int row)
+{
+    if (row < 0 || row >= m_rows.size())
+    {
+        return;
+    }
+    m_rowGenerations[row] = ++m_generation;
+    if (!m_rows[row].IsEmpty())
+    {
+        --m_seriesCount;
+        m_rows[row] = ActivityPyramid();
+    }
+}
+
+bool ActivityOverlay::IsEmpty() const
+{
+    return m_seriesCount == 0;
+}
+
+void ActivityOverlay::OnBuilt(int row, int generation, const ActivityPyramid& pyramid)
+{
+    if (row < 0 || row >= m_rows.size() || m_rowGenerations[row] != generation)
+    {
+        return;
+    }
+    m_seriesCount += (m_rows[row].IsEmpty() ? 1 : 0) - (pyramid.IsEmpty() ? 1 : 0);
+    m_rows[row] = pyramid;
+    if (!pyramid.IsEmpty())
+    {
+        emit SeriesReady(row, pyramid.StartTick(), pyramid.EndTick());
+    }
+}
+
+// 每个像素画一条从最小值到最大值的竖线，所有竖线一次画出
+void ActivityOverlay::Paint(QPainter* painter, int row, const QRect& rowRect, const TimeScale& scale,
+                            int origin, int firstPixel, int lastPixel)
+{
+    if (row < 0 || row >= m_rows.size() || m_rows[row].IsEmpty() || rowRect.height() < 2)
+    {
+        return;
+    }
+    const ActivityPyramid& pyramid = m_rows[row];
+    pyramid.Sample(scale, firstPixel, lastPixel, m_minValues, m_maxValues);
+
+    float low = pyramid.MinValue();
+    float range = pyramid.MaxValue() - low;
+    int bottom = rowRect.bottom() - 1;
+    int height = rowRect.height() - 2;
+    QVector<QLine> lines;
+    lines.reserve(m_minValues.size());
+    for (int i = 0; i < m_minValues.size(); ++i)
+    {
+        if (m_minValues[i] > m_maxValues[i])
+        {
+            continue;
+        }
+        int x = origin + firstPixel + i;
+        int y1 = range > 0 ? bottom - qRound((m_minValues[i] - low) / range * height) : bottom - height / 2;
+        int y2 = range > 0 ? bottom - qRound((m_maxValues[i] - low) / range * height) : y1;
+        lines.push_back(QLine(x, y1, x, y2));
+    }
+    if (!lines.isEmpty())
+    {
+        painter->save();
+        painter->setPen(QColor(0, 128, 0, 160));
+        painter->drawLines(lines);
+        painter->restore();
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef ACTIVITYOVERLAY_H
+#define ACTIVITYOVERLAY_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+#include "activitypyramid.h"
+
+class QPainter;
+
+// 每行的活动量/波形叠加层
+// SetSeries之后在线程池中建立最小/最大值金字塔，完成前该行不显示，完成后通过SeriesReady通知重绘
+class ActivityOverlay : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ActivityOverlay(QObject* parent);
+    virtual ~ActivityOverlay();
+
+    // 行数变化时丢弃所有序列
+    void SetRowCount(int rowCount);
+    void SetSeries(int row, const QVector<float>& samples, qint64 startTick, qint64 ticksPerSample);
+    void ClearSeries(int row);
+    bool IsEmpty() const;
+
+    // 在rowRect内画出像素[firstPixel, lastPixel]的波形，origin为时间轴起点的视口坐标
+    void Paint(QPainter* painter, int row, const QRect& rowRect, const TimeScale& scale,
+               int origin, int firstPixel, int lastPixel);
+
+signals:
+    void SeriesReady(int row, qint64 startTick, qint64 endTick);
+
+private slots:
+    void OnBuilt(int row, int generation, const ActivityPyramid& pyramid);
+
+private:
+    QThreadPool m_pool;
+    QVector<ActivityPyramid> m_rows;
+    QVector<int> m_rowGenerations;  // 同一行的序列被替换后，之前还没建完的结果作废
+    int m_generation;
+    int m_seriesCount;
+    QVector<float> m_minValues;
+    QVector<float> m_maxValues;
+};
+
+#endif // ACTIVITYOVERLAY_H
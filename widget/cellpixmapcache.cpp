@@ -0,0 +1,65 @@
+#include "cellpixmapcache.h"
+
+#include <QHash>
+
+uint qHash(const CellPixmapCache::Key& key, uint seed)
+{
+    uint hash = qHash(key.row, seed);
+    hash = hash*31 + qHash(key.col, seed);
+    hash = hash*31 + qHash(key.width, seed);
+    hash = hash*31 + qHash(key.height, seed);
+    hash = hash*31 + qHash(key.imageKey, seed);
+    return hash*31 + qHash(key.generation, seed);
+}
+
+CellPixmapCache::CellPixmapCache(qint64 budgetBytes)
+    : m_generation(0)
+{
+    SetBudget(budgetBytes);
+}
+
+void CellPixmapCache::SetBudget(qint64 budgetBytes)
+{
+    m_cache.setMaxCost(static_cast<int>(qBound(Q_INT64_C(1), budgetBytes/1024, Q_INT64_C(0x7fffffff))));
+}
+
+qint64 CellPixmapCache::Budget() const
+{
+    return static_cast<qint64>(m_cache.maxCost()) * 1024;
+}
+
+void CellPixmapCache::Invalidate()
+{
+    ++m_generation;
+    m_cache.clear();
+}
+
+QPixmap CellPixmapCache::Get(int row, int col, const QImage& image, const QSize& size)
+{
+    if (image.isNull() || size.isEmpty())
+    {
+        return QPixmap();
+    }
+
+    Key key;
+    key.row = row;
+    key.col = col;
+    key.width = size.width();
+    key.height = size.height();
+    key.imageKey = image.cacheKey();
+    key.generation = m_generation;
+
+    QPixmap* cached = m_cache.object(key);
+    if (cached)
+    {
+        return *cached;
+    }
+
+    QImage scaled = image.size() == size ? image : image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    scaled = scaled.convertToFormat(scaled.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+    QPixmap* pixmap = new QPixmap(QPixmap::fromImage(scaled));
+    int cost = qMax(1, pixmap->width() * pixmap->height() * pixmap->depth() / 8 / 1024);
+    QPixmap result = *pixmap;
+    m_cache.insert(key, pixmap, cost);
+    return result;
+}
@@ -0,0 +1,45 @@
+#ifndef CELLPIXMAPCACHE_H
+#define CELLPIXMAPCACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QPixmap>
+
+// 单元格缩略图的像素图缓存
+// 每张缩略图只按单元格大小缩放并转换成预乘格式一次，之后绘制直接贴图。
+// 键包含行、列、尺寸、图像的cacheKey和缓存代数，图像被替换或布局重建后旧条目自然失效，
+// 按字节预算做LRU淘汰
+class CellPixmapCache
+{
+public:
+    explicit CellPixmapCache(qint64 budgetBytes = 64*1024*1024);
+
+    void SetBudget(qint64 budgetBytes);
+    qint64 Budget() const;
+    void Invalidate();
+
+    QPixmap Get(int row, int col, const QImage& image, const QSize& size);
+
+private:
+    struct Key
+    {
+        int row;
+        int col;
+        int width;
+        int height;
+        qint64 imageKey;
+        int generation;
+
+        bool operator == (const Key& other) const
+        {
+            return row == other.row && col == other.col && width == other.width && height == other.height
+                    && imageKey == other.imageKey && generation == other.generation;
+        }
+    };
+    friend uint qHash(const Key& key, uint seed);
+
+    QCache<Key, QPixmap> m_cache;   // 代价以KB计，避免int溢出
+    int m_generation;
+};
+
+#endif // CELLPIXMAPCACHE_H
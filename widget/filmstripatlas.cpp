@@ -0,0 +1,285 @@
+#include "filmstripatlas.h"
+#include "tracer.h"
+
+#include <QRunnable>
+#include <QPainter>
+#include <QThread>
+#include <QVector>
+
+class FilmstripPageTask : public QRunnable
+{
+public:
+    explicit FilmstripPageTask(FilmstripAtlas* owner, int row, int level, qint64 page, int generation, const QSize& frameSize,
+                               const QVector<qint64>& ticks, const QSharedPointer<ThumbnailProvider>& provider)
+        : m_owner(owner)
+        , m_row(row)
+        , m_level(level)
+        , m_page(page)
+        , m_generation(generation)
+        , m_frameSize(frameSize)
+        , m_ticks(ticks)
+        , m_providerPtr(provider)
+    {}
+    virtual ~FilmstripPageTask() {}
+
+private:
+    virtual void run()
+    {
+        VMERGE_TRACE_SCOPE("filmstrip.build");
+        QImage page(m_frameSize.width() * FilmstripAtlas::PageColumns, m_frameSize.height() * FilmstripAtlas::PageRows,
+                    QImage::Format_ARGB32_Premultiplied);
+        page.fill(Qt::transparent);
+        QPainter painter(&page);
+        for (int i = 0; i < m_ticks.size(); ++i)
+        {
+            qint64 frame = m_page * FilmstripAtlas::PageFrames + i;
+            QImage image = m_providerPtr->Frame(m_row, m_ticks[i], m_frameSize);
+            // 每列一帧时帧序号就是列号，可以直接用单元格缩略图
+            if (image.isNull() && m_level == 0)
+            {
+                image = m_providerPtr->Thumbnail(m_row, static_cast<int>(frame), m_frameSize);
+            }
+            if (!image.isNull())
+            {
+                QRect target((i % FilmstripAtlas::PageColumns) * m_frameSize.width(), (i / FilmstripAtlas::PageColumns) * m_frameSize.height(),
+                             m_frameSize.width(), m_frameSize.height());
+                painter.drawImage(target, image);
+            }
+        }
+        painter.end();
+        QMetaObject::invokeMethod(m_owner, "OnPageBuilt", Qt::QueuedConnection,
+                                  Q_ARG(int, m_row), Q_ARG(int, m_level), Q_ARG(qint64, m_page),
+                                  Q_ARG(int, m_generation), Q_ARG(QImage, page));
+    }
+
+private:
+    FilmstripAtlas* m_owner;
+    int m_row;
+    int m_level;
+    qint64 m_page;
+    int m_generation;
+    QSize m_frameSize;
+    QVector<qint64> m_ticks;
+    QSharedPointer<ThumbnailProvider> m_providerPtr;
+};
+
+uint qHash(const FilmstripAtlas::Key& key, uint seed)
+{
+    uint hash = qHash(key.row, seed);
+    hash = hash*31 + qHash(key.level, seed);
+    return hash*31 + qHash(key.page, seed);
+}
+
+FilmstripAtlas::FilmstripAtlas(QObject* parent)
+    : QObject(parent)
+    , m_bytes(0)
+    , m_budget(128*1024*1024)
+    , m_spanTicks(0)
+    , m_columnCount(0)
+    , m_currentLevel(0)
+    , m_useCounter(0)
+    , m_generation(0)
+{
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    for (int i = 0; i <= MaxLevel; ++i)
+    {
+        m_levelBytes[i] = 0;
+    }
+}
+
+FilmstripAtlas::~FilmstripAtlas()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void FilmstripAtlas::SetProvider(const QSharedPointer<ThumbnailProvider>& provider)
+{
+    m_providerPtr = provider;
+    Clear();
+}
+
+void FilmstripAtlas::SetMaxThreads(int count)
+{
+    m_pool.setMaxThreadCount(qMax(1, count));
+}
+
+void FilmstripAtlas::SetBudget(qint64 budgetBytes)
+{
+    m_budget = qMax(Q_INT64_C(1), budgetBytes);
+    Evict();
+}
+
+void FilmstripAtlas::SetLayout(const QSize& frameSize, qint64 spanTicks, int columnCount)
+{
+    if (frameSize == m_frameSize && spanTicks == m_spanTicks && columnCount == m_columnCount)
+    {
+        return;
+    }
+    m_frameSize = frameSize;
+    m_spanTicks = spanTicks;
+    m_columnCount = columnCount;
+    Clear();
+}
+
+// 当前层级的页最后才被淘汰
+void FilmstripAtlas::SetCurrentLevel(int level)
+{
+    m_currentLevel = qBound(0, level, static_cast<int>(MaxLevel));
+}
+
+// 丢弃所有页，排队中和正在生成的结果也不再需要
+void FilmstripAtlas::Clear()
+{
+    ++m_generation;
+    m_pool.clear();
+    m_pages.clear();
+    m_bytes = 0;
+    for (int i = 0; i <= MaxLevel; ++i)
+    {
+        m_levelBytes[i] = 0;
+    }
+}
+
+bool FilmstripAtlas::Locate(int row, int level, qint64 frame, QPixmap* page, QRect* source)
+{
+    if (!m_providerPtr || m_frameSize.isEmpty() || level < 0 || level > MaxLevel || frame < 0 || frame >= FrameCount(level))
+    {
+        return false;
+    }
+
+    Key key;
+    key.row = row;
+    key.level = level;
+    key.page = frame / PageFrames;
+    QHash<Key, Page>::iterator it = m_pages.find(key);
+    if (it == m_pages.end())
+    {
+        Page pending;
+        pending.bytes = 0;
+        pending.lastUsed = ++m_useCounter;
+        m_pages.insert(key, pending);
+
+        QVector<qint64> ticks;
+        qint64 first = key.page * PageFrames;
+        qint64 last = qMin(FrameCount(level), first + PageFrames) - 1;
+        ticks.reserve(static_cast<int>(last - first + 1));
+        for (qint64 i = first; i <= last; ++i)
+        {
+            ticks.push_back(FrameTick(level, i));
+        }
+        m_pool.start(new FilmstripPageTask(this, row, level, key.page, m_generation, m_frameSize, ticks, m_providerPtr));
+        return false;
+    }
+
+    it.value().lastUsed = ++m_useCounter;
+    if (it.value().pixmap.isNull())
+    {
+        return false;
+    }
+    int slot = static_cast<int>(frame % PageFrames);
+    *page = it.value().pixmap;
+    *source = QRect((slot % PageColumns) * m_frameSize.width(), (slot / PageColumns) * m_frameSize.height(),
+                    m_frameSize.width(), m_frameSize.height());
+    return true;
+}
+
+void FilmstripAtlas::OnPageBuilt(int row, int level, qint64 page, int generation, const QImage& image)
+{
+    // Clear之后才完成的结果已经过期，被淘汰的页也不再保存
+    if (generation != m_generation)
+    {
+        return;
+    }
+    Key key;
+    key.row = row;
+    key.level = level;
+    key.page = page;
+    QHash<Key, Page>::iterator it = m_pages.find(key);
+    if (it == m_pages.end() || !it.value().pixmap.isNull())
+    {
+        return;
+    }
+    it.value().pixmap = QPixmap::fromImage(image);
+    it.value().bytes = static_cast<qint64>(image.bytesPerLine()) * image.height();
+    m_levelBytes[level] += it.value().bytes;
+    m_bytes += it.value().bytes;
+
+    qint64 first = page * PageFrames;
+    qint64 last = qMin(FrameCount(level), first + PageFrames) - 1;
+    emit PageReady(row, FrameTick(level, first), FrameTick(level, last + 1) - 1);
+    Evict();
+}
+
+qint64 FilmstripAtlas::FrameCount(int level) const
+{
+    return static_cast<qint64>(m_columnCount) << level;
+}
+
+// 帧按时长均分，不要求每列刻度数能被帧数整除
+qint64 FilmstripAtlas::FrameTick(int level, qint64 frame) const
+{
+    qint64 frames = FrameCount(level);
+    return frames > 0 ? frame * m_spanTicks / frames : 0;
+}
+
+void FilmstripAtlas::Evict()
+{
+    while (m_bytes > m_budget)
+    {
+        int farthest = -1;
+        for (int level = 0; level <= MaxLevel; ++level)
+        {
+            if (level != m_currentLevel && m_levelBytes[level] > 0
+                    && (farthest < 0 || qAbs(level - m_currentLevel) > qAbs(farthest - m_currentLevel)))
+            {
+                farthest = level;
+            }
+        }
+        if (farthest >= 0)
+        {
+            RemoveLevel(farthest);
+            continue;
+        }
+
+        // 只剩当前层级时丢弃最久未用的页，最后使用的一页总是保留
+        QHash<Key, Page>::iterator oldest = m_pages.end();
+        int built = 0;
+        for (QHash<Key, Page>::iterator it = m_pages.begin(); it != m_pages.end(); ++it)
+        {
+            if (!it.value().pixmap.isNull())
+            {
+                ++built;
+                if (oldest == m_pages.end() || it.value().lastUsed < oldest.value().lastUsed)
+                {
+                    oldest = it;
+                }
+            }
+        }
+        if (built <= 1)
+        {
+            break;
+        }
+        m_levelBytes[oldest.key().level] -= oldest.value().bytes;
+        m_bytes -= oldest.value().bytes;
+        m_pages.erase(oldest);
+    }
+}
+
+// 整层丢弃，包括还在生成中的页
+void FilmstripAtlas::RemoveLevel(int level)
+{
+    for (QHash<Key, Page>::iterator it = m_pages.begin(); it != m_pages.end(); )
+    {
+        if (it.key().level == level)
+        {
+            it = m_pages.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    m_bytes -= m_levelBytes[level];
+    m_levelBytes[level] = 0;
+}
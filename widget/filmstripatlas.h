@@ -0,0 +1,89 @@
+#ifndef FILMSTRIPATLAS_H
+#define FILMSTRIPATLAS_H
+
+#include <QObject>
+#include <QHash>
+#include <QPixmap>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include "thumbnailprovider.h"
+
+// 胶片条缩略图图集
+// 第level层每列有2^level帧，同一行连续的PageFrames帧打包在一张页图中，
+// 绘制时从少数几张大像素图中批量贴出子矩形，不必每帧单独绘制。
+// 页图在线程池中生成；超出字节预算时整层丢弃离当前层级最远的层，只剩当前层时丢弃最久未用的页
+class FilmstripAtlas : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum {
+        PageColumns = 8,
+        PageRows = 8,
+        PageFrames = PageColumns * PageRows,
+        MaxLevel = 6,
+    };
+
+    explicit FilmstripAtlas(QObject* parent);
+    virtual ~FilmstripAtlas();
+
+    void SetProvider(const QSharedPointer<ThumbnailProvider>& provider);
+    void SetMaxThreads(int count);
+    void SetBudget(qint64 budgetBytes);
+    // 帧尺寸、时长或列数变化后所有页都要重建
+    void SetLayout(const QSize& frameSize, qint64 spanTicks, int columnCount);
+    void SetCurrentLevel(int level);
+    void Clear();
+
+    // 取第frame帧所在的页图和帧在页中的位置，页还没生成时排队生成并返回false
+    bool Locate(int row, int level, qint64 frame, QPixmap* page, QRect* source);
+
+signals:
+    // 页图生成完成，参数为该页覆盖的刻度范围
+    void PageReady(int row, qint64 startTick, qint64 endTick);
+
+private slots:
+    void OnPageBuilt(int row, int level, qint64 page, int generation, const QImage& image);
+
+private:
+    struct Key
+    {
+        int row;
+        int level;
+        qint64 page;
+
+        bool operator == (const Key& other) const
+        {
+            return row == other.row && level == other.level && page == other.page;
+        }
+    };
+    friend uint qHash(const Key& key, uint seed);
+
+    struct Page
+    {
+        QPixmap pixmap;     // 为空表示正在生成
+        qint64 bytes;
+        quint64 lastUsed;
+    };
+
+    qint64 FrameCount(int level) const;
+    qint64 FrameTick(int level, qint64 frame) const;
+    void Evict();
+    void RemoveLevel(int level);
+
+private:
+    QThreadPool m_pool;
+    QSharedPointer<ThumbnailProvider> m_providerPtr;
+    QHash<Key, Page> m_pages;
+    qint64 m_levelBytes[MaxLevel + 1];
+    qint64 m_bytes;
+    qint64 m_budget;
+    QSize m_frameSize;
+    qint64 m_spanTicks;
+    int m_columnCount;
+    int m_currentLevel;
+    quint64 m_useCounter;
+    int m_generation;   // 只在GUI线程中访问
+};
+
+#endif // FILMSTRIPATLAS_H
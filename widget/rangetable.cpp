@@ -0,0 +1,1661 @@
+#include "rangetable.h"
+#include "tracer.h"
+
+#include <QHeaderView>
+#include <QPaintEvent>
+#include <QKeyEvent>
+#include <QWheelEvent>
+#include <QPainter>
+#include <QStyledItemDelegate>
+#include <QScrollBar>
+#include <QHash>
+#include <QScreen>
+#include <QWindow>
+#include <QGuiApplication>
+#include <QCache>
+#include <QStaticText>
+#include <QRunnable>
+#include <stdlib.h>
+#include <algorithm>
+#include <cmath>
+
+// 在快照上生成合并计划，界面线程同时编辑不会影响结果
+class RowTimesExportTask : public QRunnable
+{
+public:
+    explicit RowTimesExportTask(QObject* owner, const SelectionSnapshot& snapshot)
+        : m_owner(owner)
+        , m_snapshot(snapshot)
+    {}
+    virtual ~RowTimesExportTask() {}
+
+private:
+    virtual void run()
+    {
+        QVector<RowTimeRange> times = m_snapshot.GetRowTimes();
+        QMetaObject::invokeMethod(m_owner, "RowTimesExported", Qt::QueuedConnection,
+                                  Q_ARG(quint64, m_snapshot.Revision()), Q_ARG(QVector<RowTimeRange>, times));
+    }
+
+private:
+    QObject* m_owner;
+    SelectionSnapshot m_snapshot;
+};
+
+class ColumnHeader : public QHeaderView
+{
+public:
+    explicit ColumnHeader(QWidget* parent, const QStringList& headerTexts, int columnWidth, int headerHeight, Qt::Alignment alignment)
+        : QHeaderView(Qt::Horizontal, parent)
+        , m_texts(headerTexts)
+        , m_width(columnWidth)
+        , m_height(headerHeight)
+        , m_align(alignment)
+        , m_scale(nullptr)
+        , m_ticksPerSecond(0)
+        , m_spanTicks(0)
+        , m_labelFormat(-1)
+    {
+        setSectionResizeMode(QHeaderView::Fixed);
+        setMinimumSectionSize(1);
+    }
+    virtual ~ColumnHeader() {}
+
+    // 重新布局时沿用同一个表头，只替换文字
+    void SetTexts(const QStringList& headerTexts, int columnWidth, Qt::Alignment alignment)
+    {
+        m_texts = headerTexts;
+        m_width = columnWidth;
+        m_align = alignment;
+        viewport()->update();
+    }
+
+    Qt::Alignment Alignment() const
+    {
+        return m_align;
+    }
+
+    // 标尺模式：刻度和时间标签按可见范围内的时间比例生成，不再使用列标签；scale为空时恢复列标签
+    void SetRuler(const TimeScale* scale, int ticksPerSecond, qint64 spanTicks)
+    {
+        m_scale = scale;
+        m_ticksPerSecond = ticksPerSecond;
+        m_spanTicks = spanTicks;
+        viewport()->update();
+    }
+
+private:
+    virtual void paintSection(QPainter *painter, const QRect &rect, int logicalIndex) const
+    {
+        if (logicalIndex >= 0 && logicalIndex < m_texts.size())
+        {
+            painter->drawText(rect, m_align|Qt::AlignTop, m_texts[logicalIndex]);
+            painter->drawLine(rect.left(), height()/2, rect.left(), height());
+
+            int section = 6;
+            for (int i = 1; i < section; ++i)
+            {
+                painter->drawLine(rect.left() + i*rect.width()/section, height()-2,
+                                  rect.left() + i*rect.width()/section, height());
+            }
+
+        }
+    }
+
+    virtual QSize sizeHint() const
+    {
+        return QSize(m_width, m_height);
+    }
+
+    virtual void paintEvent(QPaintEvent *event)
+    {
+        if (!m_scale)
+        {
+            VMERGE_TRACE_SCOPE("paint.columnHeader");
+            QHeaderView::paintEvent(event);
+            return;
+        }
+        VMERGE_TRACE_SCOPE("paint.ruler");
+        QPainter painter(viewport());
+        PaintRuler(&painter, event->rect());
+    }
+
+    // 标签间距不小于最长标签的宽度，次刻度间距不小于6像素，步长取常用的时间间隔
+    void PaintRuler(QPainter* painter, const QRect& dirtyRect)
+    {
+        if (count() == 0 || !m_scale->IsValid() || m_ticksPerSecond <= 0)
+        {
+            return;
+        }
+        static const qint64 Steps[] = {
+            10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 15000, 30000,
+            60000, 120000, 300000, 600000, 900000, 1800000, 3600000, 7200000, 10800000, 21600000, 43200000, 86400000,
+        };
+        static const int StepCount = sizeof(Steps) / sizeof(Steps[0]);
+
+        double pixelsPerMs = static_cast<double>(m_scale->pixelsPerTick) / (Q_INT64_C(1) << TimeScale::FractionBits)
+                * m_ticksPerSecond / 1000;
+        int labelWidth = fontMetrics().boundingRect(QString("00:00:00.00")).width() + 8;
+        int major = StepCount - 1;
+        for (int i = 0; i < StepCount; ++i)
+        {
+            // 步长至少一个刻度
+            if (Steps[i] * m_ticksPerSecond >= 1000 && Steps[i] * pixelsPerMs >= labelWidth)
+            {
+                major = i;
+                break;
+            }
+        }
+        int minor = -1;
+        for (int i = 0; i < major; ++i)
+        {
+            if (Steps[major] % Steps[i] == 0 && Steps[i] * m_ticksPerSecond >= 1000 && Steps[i] * pixelsPerMs >= 6)
+            {
+                minor = i;
+                break;
+            }
+        }
+        SetLabelFormat(Steps[major]);
+
+        int origin = sectionViewportPosition(0);
+        qint64 firstMs = qMax(Q_INT64_C(0), m_scale->ToTick(dirtyRect.left() - labelWidth - origin) * 1000 / m_ticksPerSecond);
+        qint64 lastMs = m_scale->ToTick(dirtyRect.right() + 1 - origin) * 1000 / m_ticksPerSecond;
+        qint64 endMs = m_spanTicks * 1000 / m_ticksPerSecond;
+        lastMs = qMin(lastMs, endMs);
+
+        if (minor >= 0)
+        {
+            for (qint64 ms = firstMs / Steps[minor] * Steps[minor]; ms <= lastMs; ms += Steps[minor])
+            {
+                int x = origin + m_scale->ToPixel(ms * m_ticksPerSecond / 1000);
+                painter->drawLine(x, height() - 3, x, height());
+            }
+        }
+        for (qint64 ms = firstMs / Steps[major] * Steps[major]; ms <= lastMs; ms += Steps[major])
+        {
+            int x = origin + m_scale->ToPixel(ms * m_ticksPerSecond / 1000);
+            painter->drawLine(x, height() / 2, x, height());
+            painter->drawStaticText(x + 2, 0, Label(ms));
+        }
+    }
+
+    // 标签格式随步长变化：有小时时显示h:mm:ss，步长不足一秒时带小数
+    void SetLabelFormat(qint64 step)
+    {
+        int format = (m_spanTicks >= Q_INT64_C(3600) * m_ticksPerSecond ? 4 : 0) + (step < 100 ? 2 : (step < 1000 ? 1 : 0));
+        if (format != m_labelFormat)
+        {
+            m_labelFormat = format;
+            m_labels.clear();
+        }
+    }
+
+    // 标签文字只排版一次，之后每次重绘直接绘制缓存的字形
+    const QStaticText& Label(qint64 ms)
+    {
+        QHash<qint64, QStaticText>::const_iterator it = m_labels.constFind(ms);
+        if (it != m_labels.constEnd())
+        {
+            return it.value();
+        }
+        if (m_labels.size() >= 1024)
+        {
+            m_labels.clear();
+        }
+        QString text = (m_labelFormat & 4)
+                ? QString("%1:%2:%3").arg(ms / 3600000).arg(ms / 60000 % 60, 2, 10, QChar('0')).arg(ms / 1000 % 60, 2, 10, QChar('0'))
+                : QString("%1:%2").arg(ms / 60000, 2, 10, QChar('0')).arg(ms / 1000 % 60, 2, 10, QChar('0'));
+        if (m_labelFormat & 2)
+        {
+            text += QString(".%1").arg(ms % 1000 / 10, 2, 10, QChar('0'));
+        }
+        else if (m_labelFormat & 1)
+        {
+            text += QString(".%1").arg(ms % 1000 / 100);
+        }
+        QStaticText label(text);
+        label.setTextFormat(Qt::PlainText);
+        label.prepare(QTransform(), font());
+        return m_labels.insert(ms, label).value();
+    }
+
+private:
+    QStringList m_texts;
+    int m_width;
+    int m_height;
+    Qt::Alignment m_align;
+    const TimeScale* m_scale;
+    int m_ticksPerSecond;
+    qint64 m_spanTicks;
+    int m_labelFormat;
+    QHash<qint64, QStaticText> m_labels;
+};
+
+class RowHeader : public QHeaderView
+{
+public:
+    explicit RowHeader(QWidget* parent, const QStringList& rowHeadTexts, int headerWidth, int rowHeight)
+        : QHeaderView(Qt::Vertical, parent)
+        , m_texts(rowHeadTexts)
+        , m_width(headerWidth)
+        , m_height(rowHeight)
+    {
+        setSectionResizeMode(QHeaderView::Fixed);
+        setMinimumSectionSize(1);
+    }
+    virtual ~RowHeader() {}
+
+    void SetTexts(const QStringList& rowHeadTexts, int rowHeight)
+    {
+        m_texts = rowHeadTexts;
+        m_height = rowHeight;
+        viewport()->update();
+    }
+
+private:
+    virtual void paintSection(QPainter *painter, const QRect &rect, int logicalIndex) const
+    {
+        if (logicalIndex >= 0 && logicalIndex < m_texts.size())
+        {
+            painter->drawText(rect, Qt::AlignLeft|Qt::AlignVCenter, m_texts[logicalIndex]);
+        }
+    }
+
+    virtual QSize sizeHint() const
+    {
+        return QSize(m_width, m_height);
+    }
+
+private:
+    QStringList m_texts;
+    int m_width;
+    int m_height;
+};
+
+Q_DECLARE_METATYPE(RowPixelRange);
+class RangeTableModel : public QAbstractTableModel
+{
+public:
+    enum {
+        Selections_Role = Qt::UserRole,
+        Highlight_Role,
+        Pending_Role,
+    };
+
+    explicit RangeTableModel(QObject* parent, const SelectionIndex & selections, RowPixelRange & currentSelection)
+        : QAbstractTableModel(parent)
+        , m_rowCount(0)
+        , m_columnCount(0)
+        , m_selections(selections)
+        , m_currentSelection(currentSelection)
+    {}
+    virtual ~RangeTableModel() {}
+
+    // 单元格数据稀疏保存，不再按行列预先分配；重新布局时沿用同一个模型，整体重置
+    void SetDataSize(int rowCount, int columnCount)
+    {
+        beginResetModel();
+        m_rowCount = rowCount;
+        m_columnCount = columnCount;
+
+        m_dataMap.clear();
+        m_providedMap.clear();
+        m_pending.clear();
+        endResetModel();
+    }
+
+    // 提供者给出的缩略图按字节预算做LRU淘汰，直接添加的数据常驻
+    void SetProvidedBudget(qint64 budgetBytes)
+    {
+        m_providedMap.setMaxCost(static_cast<int>(qBound(Q_INT64_C(1), budgetBytes/1024, Q_INT64_C(0x7fffffff))));
+    }
+
+    void AddCellData(int row, int col, const QImage& data)
+    {
+        if (row >= 0 && row < m_rowCount && col >= 0 && col < m_columnCount)
+        {
+            qint64 key = CellKey(row, col);
+            m_dataMap.insert(key, data);
+            m_providedMap.remove(key);
+            m_pending.remove(key);
+            dataChanged(index(row, col), index(row, col));
+        }
+    }
+
+    // 异步加载的结果按请求时的类型保存
+    void AddLoadedData(int row, int col, const QImage& data)
+    {
+        qint64 key = CellKey(row, col);
+        if (!m_pending.contains(key))
+        {
+            return;
+        }
+        if (!m_pending.value(key))
+        {
+            AddCellData(row, col, data);
+            return;
+        }
+        m_pending.remove(key);
+        if (!data.isNull())
+        {
+            int cost = qMax(1, data.bytesPerLine() * data.height() / 1024);
+            m_providedMap.insert(key, new QImage(data), cost);
+        }
+        dataChanged(index(row, col), index(row, col));
+    }
+
+    // 异步解码期间单元格显示占位
+    void SetCellPending(int row, int col, bool provided)
+    {
+        if (row >= 0 && row < m_rowCount && col >= 0 && col < m_columnCount)
+        {
+            m_pending.insert(CellKey(row, col), provided);
+            dataChanged(index(row, col), index(row, col));
+        }
+    }
+
+    // 有数据、正在加载或者已被淘汰都需要区分，只有后两者之外的才需要向提供者请求
+    bool HasCellData(int row, int col) const
+    {
+        qint64 key = CellKey(row, col);
+        return m_dataMap.contains(key) || m_providedMap.contains(key) || m_pending.contains(key);
+    }
+
+private:
+    static qint64 CellKey(int row, int col)
+    {
+        return (static_cast<qint64>(row) << 32) | static_cast<quint32>(col);
+    }
+
+    // QAbstractItemModel interface
+private:
+    int rowCount(const QModelIndex &parent) const
+    {
+        Q_UNUSED(parent);
+        return m_rowCount;
+    }
+    int columnCount(const QModelIndex &parent) const
+    {
+        Q_UNUSED(parent);
+        return m_columnCount;
+    }
+    QVariant data(const QModelIndex &index, int role) const
+    {
+        switch (role)
+        {
+        case Qt::DisplayRole:
+            {
+            qint64 key = CellKey(index.row(), index.column());
+            QHash<qint64, QImage>::const_iterator it = m_dataMap.constFind(key);
+            if (it != m_dataMap.constEnd())
+            {
+                return it.value();
+            }
+            // object()同时刷新LRU顺序，正在显示的缩略图最后才会被淘汰
+            QImage* provided = m_providedMap.object(key);
+            return provided ? *provided : QImage();
+            }
+        case Selections_Role:
+            {
+            QVariant roleData;
+            roleData.setValue(m_selections.Runs(index.row()));
+            return roleData;
+            }
+        case Highlight_Role:
+            {
+            QVariant roleData;
+            roleData.setValue(m_currentSelection);
+            return roleData;
+            }
+        case Pending_Role:
+            return m_pending.contains(CellKey(index.row(), index.column()));
+        default:
+            break;
+        }
+        return QVariant();
+    }
+
+private:
+    int m_rowCount;
+    int m_columnCount;
+    QHash<qint64, QImage> m_dataMap;
+    QCache<qint64, QImage> m_providedMap;
+    QHash<qint64, bool> m_pending;  // 值表示是否来自提供者
+    const SelectionIndex& m_selections;
+    RowPixelRange& m_currentSelection;
+};
+
+class RangeTableDelegate : public QStyledItemDelegate
+{
+public:
+    explicit RangeTableDelegate(QObject* parent, const TimeScale& timeScale, CellPixmapCache& pixmapCache)
+        : QStyledItemDelegate(parent)
+        , m_timeScale(timeScale)
+        , m_pixmapCache(pixmapCache)
+        , m_drawSelections(true)
+        , m_drawImages(true) {}
+    virtual ~RangeTableDelegate() {}
+
+    // 按行绘制选择时，单元格只负责缩略图
+    void SetDrawSelections(bool drawSelections)
+    {
+        m_drawSelections = drawSelections;
+    }
+
+    // 胶片条模式下缩略图由视图从图集中批量绘制
+    void SetDrawImages(bool drawImages)
+    {
+        m_drawImages = drawImages;
+    }
+
+private:
+    virtual void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+    {
+        if (index.row() < 0 || index.column() < 0)
+        {
+            return;
+        }
+
+        // 缩放和格式转换只在第一次绘制时做，之后直接贴图
+        QImage image = m_drawImages ? index.data(Qt::DisplayRole).value<QImage>() : QImage();
+        if (!image.isNull())
+        {
+            painter->drawPixmap(option.rect.topLeft(), m_pixmapCache.Get(index.row(), index.column(), image, option.rect.size()));
+        }
+        else if (m_drawImages && index.data(RangeTableModel::Pending_Role).toBool())
+        {
+            painter->fillRect(option.rect.adjusted(2, 2, -2, -2), QColor(0, 0, 0, 24));
+        }
+        painter->drawLine(option.rect.bottomLeft(), option.rect.bottomRight());
+        if (!m_drawSelections)
+        {
+            return;
+        }
+
+        // 绘制已选范围
+        const SelectionIndex::RunMap rowSelections = index.data(RangeTableModel::Selections_Role).value<SelectionIndex::RunMap>();
+        PixelRange cellRange;
+        cellRange.start = option.rect.left();
+        cellRange.end = option.rect.right();
+        const QTableView* viewPtr = dynamic_cast<const QTableView*>(option.widget);
+        if (viewPtr)
+        {
+            cellRange.start -= viewPtr->columnViewportPosition(0);
+            cellRange.end -= viewPtr->columnViewportPosition(0);
+        }
+        // 只遍历和本格相交的片段，片段以刻度保存，绘制时才换算成像素
+        qint64 cellStartTick = m_timeScale.ToTick(cellRange.start);
+        qint64 cellEndTick = m_timeScale.ToTick(cellRange.end + 1) - 1;
+        SelectionIndex::RunMap::const_iterator it = SelectionIndex::FirstRunAfter(rowSelections, cellStartTick);
+        for (; it != rowSelections.constEnd() && it.key() <= cellEndTick; ++it)
+        {
+            PixelRange runRange;
+            runRange.start = m_timeScale.ToPixel(it.key());
+            runRange.end = qMax(runRange.start, m_timeScale.ToPixel(it.value() + 1) - 1);
+            PixelRange intersection = cellRange.Intersection(runRange);
+            if (intersection.IsValid())
+            {
+                QRect intersectionRect = option.rect;
+                intersectionRect.setLeft(intersection.start);
+                intersectionRect.setRight(intersection.end);
+                if (viewPtr)
+                {
+                    intersectionRect.moveLeft(intersectionRect.left()+viewPtr->columnViewportPosition(0));
+                }
+                painter->fillRect(intersectionRect, QBrush(QColor(0, 0, 255, 128)));
+            }
+        }
+
+        // 绘制当前选择范围
+        RowPixelRange currentSelection = index.data(RangeTableModel::Highlight_Role).value<RowPixelRange>();
+        currentSelection.Normalize();
+        if (currentSelection.IsValid() && currentSelection.row == index.row())
+        {
+            PixelRange intersection = cellRange.Intersection(currentSelection);
+            if (intersection.IsValid())
+            {
+                QRect intersectionRect = option.rect;
+                intersectionRect.setLeft(intersection.start);
+                intersectionRect.setRight(intersection.end);
+                painter->fillRect(intersectionRect, QBrush(QColor(0, 255, 0, 64)));
+            }
+        }
+    }
+
+private:
+    const TimeScale& m_timeScale;
+    CellPixmapCache& m_pixmapCache;
+    bool m_drawSelections;
+    bool m_drawImages;
+};
+
+RangeTable::RangeTable(QWidget *parent, int rowHeadWidth)
+    : QTableView(parent)
+    , m_grabAnchor(0)
+    , m_snapping(false)
+    , m_snapPixels(8)
+    , m_playheadTick(-1)
+    , m_followPlayhead(false)
+    , m_ruler(false)
+    , m_rowHeadWidth(rowHeadWidth)
+    , m_columnWidth(0)
+    , m_rowHeight(0)
+    , m_timeSpanTicks(0)
+    , m_zoom(1.0)
+    , m_zoomedColumnWidth(0)
+    , m_renderMode(Render_RowStrip)
+    , m_select2Add(true)
+    , m_grabNow(false)
+    , m_pendingCursorX(0)
+    , m_loaderPtr(new ThumbnailLoader(this))
+    , m_thumbnailBudget(256*1024*1024)
+    , m_atlasPtr(new FilmstripAtlas(this))
+    , m_filmstrip(false)
+    , m_activityPtr(new ActivityOverlay(this))
+    , m_stripSelections(false)
+{
+    // 高回报率鼠标的移动事件合并到每帧一次，只应用最后的位置
+    m_cursorTimer.setSingleShot(true);
+    m_cursorTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_cursorTimer, &QTimer::timeout, this, [this] { ApplyCursorMove(); });
+
+    // 零间隔定时器在本轮事件处理完之后触发，同一轮中的多次编辑只发一次信号
+    qRegisterMetaType<SelectionDelta>();
+    m_deltaTimer.setSingleShot(true);
+    m_deltaTimer.setInterval(0);
+    connect(&m_deltaTimer, &QTimer::timeout, this, [this] { FlushSelectionChanged(); });
+
+    qRegisterMetaType<QVector<RowTimeRange> >();
+    m_exportPool.setMaxThreadCount(1);
+
+    // 表头、模型和代理只创建一次，之后每次布局只更新内容
+    setHorizontalHeader(new ColumnHeader(this, QStringList(), 0, 20, Qt::AlignLeft));
+    setVerticalHeader(new RowHeader(this, QStringList(), m_rowHeadWidth, 0));
+    RangeTableModel* modelPtr = new RangeTableModel(this, m_engine.Selections(), m_newSelection);
+    modelPtr->SetProvidedBudget(m_thumbnailBudget);
+    setModel(modelPtr);
+    setItemDelegate(new RangeTableDelegate(this, m_timeScale, m_pixmapCache));
+    UpdateSelectionPainter();
+
+    setCornerButtonEnabled(false);
+    setShowGrid(false);
+    viewport()->setMouseTracking(true);
+    setHorizontalScrollMode(QAbstractItemView::ScrollPerPixel);
+
+    connect(m_loaderPtr, &ThumbnailLoader::Loaded, this, [this](int row, int col, const QImage& image) {
+        RangeTableModel* modelPtr = dynamic_cast<RangeTableModel*>(model());
+        if (modelPtr)
+        {
+            modelPtr->AddLoadedData(row, col, image);
+        }
+    });
+    connect(m_atlasPtr, &FilmstripAtlas::PageReady, this, [this](int row, qint64 startTick, qint64 endTick) {
+        UpdateTickSpan(row, startTick, endTick);
+    });
+    connect(m_activityPtr, &ActivityOverlay::SeriesReady, this, [this](int row, qint64 startTick, qint64 endTick) {
+        UpdateSelectionPainter();
+        UpdateTickSpan(row, startTick, endTick);
+    });
+}
+
+RangeTable::~RangeTable()
+{
+    m_exportPool.clear();
+    m_exportPool.waitForDone();
+}
+
+void RangeTable::SetHeader(const QStringList& headerTexts, int columnWidth, Qt::Alignment alignment)
+{
+    m_headTexts = headerTexts;
+    m_columnWidth = columnWidth;
+
+    m_ruler = false;
+
+    ColumnHeader* headerPtr = dynamic_cast<ColumnHeader*>(horizontalHeader());
+    if (headerPtr)
+    {
+        headerPtr->SetTexts(headerTexts, columnWidth, alignment);
+        headerPtr->SetRuler(nullptr, 0, 0);
+    }
+}
+
+// 标尺在SetupLayout之后按时间比例生成，缩放时刻度和标签密度随之变化
+void RangeTable::SetHeader(int columnCount, int columnWidth)
+{
+    QStringList headerTexts;
+    headerTexts.reserve(columnCount);
+    for (int i = 0; i < columnCount; ++i)
+    {
+        headerTexts << QString();
+    }
+    SetHeader(headerTexts, columnWidth);
+    m_ruler = true;
+}
+
+void RangeTable::SetRows(const QStringList& rowHeadTexts, int rowHeight)
+{
+    m_rowTexts = rowHeadTexts;
+    m_rowHeight = rowHeight;
+
+    RowHeader* headerPtr = dynamic_cast<RowHeader*>(verticalHeader());
+    if (headerPtr)
+    {
+        headerPtr->SetTexts(rowHeadTexts, rowHeight);
+    }
+}
+
+void RangeTable::SetupLayout(int timeSpanSeconds)
+{
+    ApplyLayout(timeSpanSeconds);
+    ResetSelection();
+}
+
+// 按当前行列重新布局，不动选择；读取工程时选择已由引擎整体替换
+void RangeTable::ApplyLayout(int timeSpanSeconds)
+{
+    VMERGE_TRACE_SCOPE("layout");
+    // 旧布局中还没解码完的单元格不再需要
+    m_loaderPtr->Cancel();
+    m_loaderPtr->SetTargetSize(QSize(m_columnWidth, m_rowHeight));
+
+    // 所有行列等高等宽，只设默认尺寸，不逐行逐列设置，布局时间和行列数无关
+    verticalHeader()->setDefaultSectionSize(m_rowHeight);
+    m_zoom = 1.0;
+    ApplyColumnWidth(m_columnWidth);
+
+    m_pixmapCache.Invalidate();
+    RangeTableModel* modelPtr = dynamic_cast<RangeTableModel*>(model());
+    modelPtr->SetDataSize(m_rowTexts.size(), m_headTexts.size());
+
+    m_cursor.SetSize(m_columnWidth, m_rowTexts.size() * m_rowHeight, fontMetrics().height());
+    m_cursor.MoveTo(0);
+
+    m_timeSpanTicks = static_cast<qint64>(timeSpanSeconds) * m_engine.TicksPerSecond();
+    m_pyramid.SetSpan(m_timeSpanTicks);
+    m_snapIndex.Reset(m_rowTexts.size());
+    m_atlasPtr->Clear();
+    m_activityPtr->SetRowCount(m_rowTexts.size());
+    UpdateSelectionPainter();
+    UpdateTimeScale();
+
+    RequestVisibleCells();
+}
+
+// 选择以整数刻度保存，默认每秒1000个刻度（毫秒），也可以设为帧率按帧保存
+// 需要在SetupLayout之前调用
+void RangeTable::SetTimeBase(int ticksPerSecond)
+{
+    m_engine.SetTimeBase(ticksPerSecond);
+}
+
+// 逐格绘制时每个单元格都要取出整行选择并求交；按行绘制时由视图每行一次画出所有可见片段
+void RangeTable::SetRenderMode(RenderMode mode)
+{
+    m_renderMode = mode;
+    UpdateSelectionPainter();
+    viewport()->update();
+}
+
+// 胶片帧和活动量曲线画在代理之后，会盖住代理画的选择；有它们时不论绘制方式，选择都由视图逐行画在最上层
+bool RangeTable::StripSelections() const
+{
+    return m_renderMode == Render_RowStrip || m_filmstrip || !m_activityPtr->IsEmpty();
+}
+
+// 活动量序列在后台建好后才算数，绘制方式可能在任意一次序列变化后切换，切换时整个视口重绘
+void RangeTable::UpdateSelectionPainter()
+{
+    bool stripSelections = StripSelections();
+    RangeTableDelegate* delegatePtr = dynamic_cast<RangeTableDelegate*>(itemDelegate());
+    if (delegatePtr)
+    {
+        delegatePtr->SetDrawSelections(!stripSelections);
+    }
+    if (stripSelections != m_stripSelections)
+    {
+        m_stripSelections = stripSelections;
+        viewport()->update();
+    }
+}
+
+void RangeTable::SetZoom(double zoom, int anchorX)
+{
+    if (!model() || m_columnWidth <= 0)
+    {
+        return;
+    }
+    // 最小缩放时每列1像素
+    zoom = qBound(1.0 / m_columnWidth, zoom, 64.0);
+    if (zoom == m_zoom)
+    {
+        return;
+    }
+    m_zoom = zoom;
+
+    // 小步缩放先累积，列宽变化了才重新布局
+    int width = qMax(1, qRound(m_columnWidth * m_zoom));
+    if (width != m_zoomedColumnWidth)
+    {
+        if (anchorX < 0)
+        {
+            anchorX = viewport()->width() / 2;
+        }
+        qint64 anchorTick = m_timeScale.ToTick(anchorX - columnViewportPosition(0));
+        ApplyColumnWidth(width);
+        UpdateTimeScale();
+        updateGeometries();
+        horizontalScrollBar()->setValue(m_timeScale.ToPixel(anchorTick) - anchorX);
+        viewport()->update();
+        RequestVisibleCells();
+    }
+    emit ZoomChanged(m_zoom);
+}
+
+double RangeTable::Zoom() const
+{
+    return m_zoom;
+}
+
+// 所有列等宽，时间比例按列宽乘列数计算
+void RangeTable::ApplyColumnWidth(int width)
+{
+    m_zoomedColumnWidth = width;
+    m_atlasPtr->SetCurrentLevel(FilmstripLevel());
+    horizontalHeader()->setDefaultSectionSize(width);
+}
+
+void RangeTable::SetPlayhead(const QTime &time)
+{
+    SetPlayheadTick(m_engine.ToTick(time));
+}
+
+// 播放头画在内容上，普通滚动时随内容一起平移，不需要修补
+// 跟随时播放头越过视口3/4处就平移视口把它留在那里，每帧只露出新的一窄条；跳到视口外时直接定位
+void RangeTable::SetPlayheadTick(qint64 tick)
+{
+    QRegion damage = PlayheadDamage();
+    m_playheadTick = tick;
+    if (m_followPlayhead && tick >= 0 && m_timeScale.IsValid())
+    {
+        int x = columnViewportPosition(0) + m_timeScale.ToPixel(tick);
+        int width = viewport()->width();
+        int target = x < 0 ? width / 4 : width * 3 / 4;
+        if (x < 0 || x > target)
+        {
+            QScrollBar* scrollBar = horizontalScrollBar();
+            int before = scrollBar->value();
+            scrollBar->setValue(before + x - target);
+            // 视口平移时旧播放头也被搬走了
+            damage += damage.translated(before - scrollBar->value(), 0);
+        }
+    }
+    damage += PlayheadDamage();
+    viewport()->update(damage);
+}
+
+qint64 RangeTable::PlayheadTick() const
+{
+    return m_playheadTick;
+}
+
+void RangeTable::SetFollowPlayhead(bool follow)
+{
+    m_followPlayhead = follow;
+    if (follow && m_playheadTick >= 0)
+    {
+        SetPlayheadTick(m_playheadTick);
+    }
+}
+
+QRect RangeTable::PlayheadDamage() const
+{
+    if (m_playheadTick < 0 || !m_timeScale.IsValid())
+    {
+        return QRect();
+    }
+    int x = columnViewportPosition(0) + m_timeScale.ToPixel(m_playheadTick);
+    return QRect(x, 0, 2, viewport()->height());
+}
+
+void RangeTable::SetSelectionMode(bool selectToAdd)
+{
+    m_select2Add = selectToAdd;
+}
+
+void RangeTable::SetSnapping(bool enabled, int thresholdPixels)
+{
+    m_snapping = enabled;
+    m_snapPixels = qMax(0, thresholdPixels);
+}
+
+// 关键帧以刻度给出，需要在SetupLayout之后设置
+void RangeTable::SetKeyframes(int row, const QVector<qint64> &ticks)
+{
+    m_snapIndex.SetKeyframes(row, ticks);
+}
+
+void RangeTable::ResetSelection()
+{
+    m_engine.Reset(model()->rowCount());
+    m_pyramid.Invalidate();
+    m_pendingDelta.Reset(model()->rowCount());
+    m_deltaTimer.stop();
+    emit SelectionReset();
+}
+
+void RangeTable::Undo()
+{
+    if (m_grabNow)
+    {
+        return;
+    }
+    OnSelectionChanged(m_engine.Undo());
+}
+
+void RangeTable::Redo()
+{
+    if (m_grabNow)
+    {
+        return;
+    }
+    OnSelectionChanged(m_engine.Redo());
+}
+
+// 批量导入的结果作为一步撤销记录，最后统一重绘一次
+SelectionDelta RangeTable::ApplySelections(const QVector<RowTickRange> &ranges, SelectionIndex::ConflictPolicy policy)
+{
+    SelectionDelta delta = m_engine.ApplySelections(ranges, policy);
+    OnSelectionChanged(delta);
+    return delta;
+}
+
+SelectionDelta RangeTable::ApplySelections(const QVector<RowTimeRange> &ranges, SelectionIndex::ConflictPolicy policy)
+{
+    SelectionDelta delta = m_engine.ApplySelections(ranges, policy);
+    OnSelectionChanged(delta);
+    return delta;
+}
+
+RangeSet RangeTable::RowSet(int row) const
+{
+    return m_engine.RowSet(row);
+}
+
+SelectionDelta RangeTable::ApplyRowSet(int row, const RangeSet &set, SelectionIndex::ConflictPolicy policy)
+{
+    SelectionDelta delta = m_engine.ApplyRowSet(row, set, policy);
+    OnSelectionChanged(delta);
+    return delta;
+}
+
+bool RangeTable::SaveProject(const QString &path)
+{
+    return m_engine.Save(path, m_timeSpanTicks, m_rowTexts, m_headTexts);
+}
+
+// 快照映射到内存后一次解码到选择索引；行列尺寸和表头对齐方式沿用当前设置
+// 引擎先解码快照并重放日志，成功后才替换行列和布局；失败时控件保持原样
+bool RangeTable::LoadProject(const QString &path, const QString &journalPath)
+{
+    VMERGE_TRACE_SCOPE("project.open");
+    ProjectFile file;
+    if (!file.Open(path) || file.TicksPerSecond() <= 0)
+    {
+        return false;
+    }
+    QStringList rowLabels = file.RowLabels();
+    QStringList columnLabels = file.ColumnLabels();
+    if (rowLabels.size() != file.RowCount() || !m_engine.Load(file, journalPath))
+    {
+        return false;
+    }
+
+    if (m_ruler)
+    {
+        SetHeader(columnLabels.size(), m_columnWidth);
+    }
+    else
+    {
+        ColumnHeader* headerPtr = dynamic_cast<ColumnHeader*>(horizontalHeader());
+        SetHeader(columnLabels, m_columnWidth, headerPtr ? headerPtr->Alignment() : Qt::AlignLeft);
+    }
+    SetRows(rowLabels, m_rowHeight);
+    ApplyLayout(static_cast<int>(file.TimeSpanTicks() / file.TicksPerSecond()));
+    m_timeSpanTicks = file.TimeSpanTicks();
+    m_pyramid.SetSpan(m_timeSpanTicks);
+    UpdateTimeScale();
+
+    m_pyramid.Invalidate();
+    m_pendingDelta.Reset(model()->rowCount());
+    m_deltaTimer.stop();
+    viewport()->update();
+    emit SelectionReset();
+    return true;
+}
+
+bool RangeTable::OpenJournal(const QString &path)
+{
+    return m_engine.OpenJournal(path);
+}
+
+void RangeTable::CloseJournal()
+{
+    m_engine.CloseJournal();
+}
+
+bool RangeTable::CanUndo() const
+{
+    return m_engine.CanUndo();
+}
+
+bool RangeTable::CanRedo() const
+{
+    return m_engine.CanRedo();
+}
+
+void RangeTable::SetHistoryBudget(qint64 bytes)
+{
+    m_engine.SetHistoryBudget(bytes);
+}
+
+void RangeTable::AddCellData(int row, int col, const QImage &data)
+{
+    RangeTableModel* modelPtr = dynamic_cast<RangeTableModel*>(model());
+    if (modelPtr)
+    {
+        modelPtr->AddCellData(row, col, data);
+    }
+}
+
+void RangeTable::AddCellData(int row, int col, const QString &path)
+{
+    if (SetCellPending(row, col))
+    {
+        m_loaderPtr->Load(row, col, path);
+    }
+}
+
+void RangeTable::AddCellData(int row, int col, QIODevice *device)
+{
+    if (SetCellPending(row, col))
+    {
+        m_loaderPtr->Load(row, col, device);
+    }
+}
+
+void RangeTable::AddCellData(int row, int col, const ThumbnailLoader::LoadFunction &loader)
+{
+    if (SetCellPending(row, col))
+    {
+        m_loaderPtr->Load(row, col, loader);
+    }
+}
+
+void RangeTable::SetPixmapCacheBudget(qint64 bytes)
+{
+    m_pixmapCache.SetBudget(bytes);
+}
+
+void RangeTable::SetDecodeThreads(int count)
+{
+    m_loaderPtr->SetMaxThreads(count);
+    m_atlasPtr->SetMaxThreads(count);
+}
+
+bool RangeTable::SetCellPending(int row, int col)
+{
+    RangeTableModel* modelPtr = dynamic_cast<RangeTableModel*>(model());
+    if (modelPtr)
+    {
+        modelPtr->SetCellPending(row, col, false);
+        return true;
+    }
+    return false;
+}
+
+// 设置提供者后，单元格数据只在进入可见区域（或即将进入）时才请求
+void RangeTable::SetThumbnailProvider(const QSharedPointer<ThumbnailProvider> &provider)
+{
+    m_providerPtr = provider;
+    m_atlasPtr->SetProvider(provider);
+    RequestVisibleCells();
+    viewport()->update();
+}
+
+void RangeTable::SetThumbnailBudget(qint64 bytes)
+{
+    m_thumbnailBudget = bytes;
+    RangeTableModel* modelPtr = dynamic_cast<RangeTableModel*>(model());
+    if (modelPtr)
+    {
+        modelPtr->SetProvidedBudget(bytes);
+    }
+}
+
+void RangeTable::SetFilmstrip(bool enabled)
+{
+    m_filmstrip = enabled;
+    RangeTableDelegate* delegatePtr = dynamic_cast<RangeTableDelegate*>(itemDelegate());
+    if (delegatePtr)
+    {
+        delegatePtr->SetDrawImages(!m_filmstrip);
+    }
+    UpdateSelectionPainter();
+    RequestVisibleCells();
+    viewport()->update();
+}
+
+void RangeTable::SetFilmstripBudget(qint64 bytes)
+{
+    m_atlasPtr->SetBudget(bytes);
+}
+
+void RangeTable::SetActivity(int row, const QVector<float> &samples, qint64 startTick, qint64 ticksPerSample)
+{
+    m_activityPtr->SetSeries(row, samples, startTick, ticksPerSample);
+}
+
+void RangeTable::ClearActivity(int row)
+{
+    m_activityPtr->ClearSeries(row);
+    UpdateSelectionPainter();
+    UpdatePixelSpan(row, 0, m_zoomedColumnWidth * m_headTexts.size() - 1);
+}
+
+// 请求可见区域的缩略图，再沿最近的滚动方向预取一屏
+// 胶片条模式下图集在绘制时按页请求，不再逐格请求
+void RangeTable::RequestVisibleCells()
+{
+    if (!m_providerPtr || m_filmstrip)
+    {
+        return;
+    }
+    QRect visible = viewport()->rect();
+    RequestCells(visible);
+    if (!m_scrollDirection.isNull())
+    {
+        RequestCells(visible.translated(m_scrollDirection.x()*visible.width(), m_scrollDirection.y()*visible.height()));
+    }
+}
+
+void RangeTable::RequestCells(const QRect &rect)
+{
+    RangeTableModel* modelPtr = dynamic_cast<RangeTableModel*>(model());
+    // 缩到列宽只有几个像素时缩略图已看不清，不再请求
+    if (!modelPtr || m_zoomedColumnWidth < 8 || m_rowHeight <= 0 || model()->rowCount() == 0 || model()->columnCount() == 0)
+    {
+        return;
+    }
+
+    // 行列都是等宽等高的，直接由像素位置算出行列范围
+    int firstCol = qBound(0, (rect.left() - columnViewportPosition(0)) / m_zoomedColumnWidth, model()->columnCount()-1);
+    int lastCol = qBound(0, (rect.right() - columnViewportPosition(0)) / m_zoomedColumnWidth, model()->columnCount()-1);
+    int firstRow = qBound(0, (rect.top() - rowViewportPosition(0)) / m_rowHeight, model()->rowCount()-1);
+    int lastRow = qBound(0, (rect.bottom() - rowViewportPosition(0)) / m_rowHeight, model()->rowCount()-1);
+
+    QSharedPointer<ThumbnailProvider> provider = m_providerPtr;
+    for (int row = firstRow; row <= lastRow; ++row)
+    {
+        for (int col = firstCol; col <= lastCol; ++col)
+        {
+            if (!modelPtr->HasCellData(row, col))
+            {
+                modelPtr->SetCellPending(row, col, true);
+                m_loaderPtr->Load(row, col, [provider, row, col](const QSize& size) -> QImage {
+                    return provider->Thumbnail(row, col, size);
+                });
+            }
+        }
+    }
+}
+
+void RangeTable::scrollContentsBy(int dx, int dy)
+{
+    // 指针固定在视口上，滚动时会被一起搬走，需要擦掉搬走的影子并重绘指针和标签
+    QRegion cursorDamage = m_cursor.Damage();
+    QTableView::scrollContentsBy(dx, dy);
+    viewport()->update(cursorDamage.translated(dx, dy) + cursorDamage);
+    // 内容左移说明在向右滚动，预取方向与内容移动方向相反
+    if (dx != 0 || dy != 0)
+    {
+        m_scrollDirection = QPoint(dx < 0 ? 1 : (dx > 0 ? -1 : 0), dy < 0 ? 1 : (dy > 0 ? -1 : 0));
+    }
+    RequestVisibleCells();
+}
+
+QVector<QVector<TimeRange> > RangeTable::GetSelectionTimes() const
+{
+    return m_engine.GetSelectionTimes();
+}
+
+QVector<RowTimeRange> RangeTable::GetRowTimes() const
+{
+    return m_engine.GetRowTimes();
+}
+
+QVector<QVector<TickRange> > RangeTable::GetSelectionTicks() const
+{
+    return m_engine.GetSelectionTicks();
+}
+
+QVector<RowTickRange> RangeTable::GetRowTicks() const
+{
+    return m_engine.GetRowTicks();
+}
+
+// 大型合并计划可以逐段处理，不必先生成整个数组
+void RangeTable::ForEachRowTick(const std::function<bool(const RowTickRange&)>& callback) const
+{
+    m_engine.ForEachRowTick(callback);
+}
+
+void RangeTable::ForEachRowTime(const std::function<bool(const RowTimeRange&)>& callback) const
+{
+    m_engine.ForEachRowTime(callback);
+}
+
+SelectionSnapshot RangeTable::Snapshot() const
+{
+    return m_engine.Snapshot();
+}
+
+void RangeTable::ExportRowTimesAsync()
+{
+    m_exportPool.start(new RowTimesExportTask(this, m_engine.Snapshot()));
+}
+
+// 列宽或列数变化时只需要重新计算换算比例，已保存的选择不受影响
+void RangeTable::UpdateTimeScale()
+{
+    m_timeScale.Setup(static_cast<qint64>(m_zoomedColumnWidth) * m_headTexts.size(), m_timeSpanTicks);
+    m_atlasPtr->SetLayout(QSize(m_columnWidth, m_rowHeight), m_timeSpanTicks, m_headTexts.size());
+    m_cursor.SetLabelMap(&m_timeScale, m_engine.TicksPerSecond());
+    ColumnHeader* headerPtr = dynamic_cast<ColumnHeader*>(horizontalHeader());
+    if (headerPtr)
+    {
+        headerPtr->SetRuler(m_ruler ? &m_timeScale : nullptr, m_engine.TicksPerSecond(), m_timeSpanTicks);
+    }
+}
+
+void RangeTable::paintEvent(QPaintEvent *event)
+{
+    VMERGE_TRACE_SCOPE("paint");
+    QTableView::paintEvent(event);
+
+    // 滚动露出的一条和指针、播放头的旧位置分开绘制，不按它们的外接矩形整块重绘
+    QPainter painter(viewport());
+    for (const QRect& rect : event->region())
+    {
+        painter.save();
+        painter.setClipRect(rect, Qt::IntersectClip);
+        if (m_filmstrip)
+        {
+            PaintFilmstrip(&painter, rect);
+        }
+        PaintActivity(&painter, rect);
+        if (StripSelections())
+        {
+            PaintSelectionStrips(&painter, rect);
+        }
+        painter.restore();
+    }
+    if (m_playheadTick >= 0 && event->region().intersects(PlayheadDamage()))
+    {
+        painter.fillRect(PlayheadDamage(), QColor(255, 128, 0, 200));
+    }
+    if (event->region().intersects(m_cursor.Damage()))
+    {
+        m_cursor.Paint(&painter, columnViewportPosition(0));
+    }
+}
+
+// 每个可见行二分查找第一个可见片段，每个可见片段只画一次
+void RangeTable::PaintSelectionStrips(QPainter *painter, const QRect &dirtyRect)
+{
+    VMERGE_TRACE_SCOPE("paint.selections");
+    if (!model() || !m_timeScale.IsValid() || m_rowHeight <= 0 || model()->rowCount() == 0)
+    {
+        return;
+    }
+
+    int origin = columnViewportPosition(0);
+    int firstRow = qBound(0, (dirtyRect.top() - rowViewportPosition(0)) / m_rowHeight, model()->rowCount()-1);
+    int lastRow = qBound(0, (dirtyRect.bottom() - rowViewportPosition(0)) / m_rowHeight, model()->rowCount()-1);
+    qint64 firstTick = m_timeScale.ToTick(dirtyRect.left() - origin);
+    qint64 lastTick = m_timeScale.ToTick(dirtyRect.right() + 1 - origin) - 1;
+
+    QBrush selectionBrush(QColor(0, 0, 255, 128));
+    QBrush partialBrush(QColor(0, 0, 255, 64));
+    bool sampleCoverage = m_pyramid.CanSample(m_timeScale);
+    QVector<quint8> coverage;
+    for (int row = firstRow; row <= lastRow; ++row)
+    {
+        int top = rowViewportPosition(row);
+        int bottom = top + rowHeight(row) - 1;
+
+        // 一个像素超过一个金字塔格子时按像素取覆盖状态，连续相同状态的像素合成一个矩形
+        if (sampleCoverage)
+        {
+            m_pyramid.Sample(m_engine.Selections(), row, m_timeScale, dirtyRect.left() - origin, dirtyRect.right() - origin, coverage);
+            for (int i = 0; i < coverage.size(); )
+            {
+                int next = i + 1;
+                while (next < coverage.size() && coverage[next] == coverage[i])
+                {
+                    ++next;
+                }
+                if (coverage[i] != CoveragePyramid::Coverage_Empty)
+                {
+                    painter->fillRect(QRect(dirtyRect.left() + i, top, next - i, bottom - top + 1),
+                                      coverage[i] == CoveragePyramid::Coverage_Full ? selectionBrush : partialBrush);
+                }
+                i = next;
+            }
+            continue;
+        }
+
+        const SelectionIndex::RunMap& runs = m_engine.Selections().Runs(row);
+        for (SelectionIndex::RunMap::const_iterator it = SelectionIndex::FirstRunAfter(runs, firstTick);
+             it != runs.constEnd() && it.key() <= lastTick; ++it)
+        {
+            int left = m_timeScale.ToPixel(it.key());
+            int right = qMax(left, m_timeScale.ToPixel(it.value() + 1) - 1);
+            painter->fillRect(QRect(QPoint(qMax(origin + left, dirtyRect.left()), top),
+                                   QPoint(qMin(origin + right, dirtyRect.right()), bottom)), selectionBrush);
+        }
+    }
+
+    // 绘制当前选择范围
+    RowPixelRange currentSelection = m_newSelection;
+    currentSelection.Normalize();
+    if (currentSelection.IsValid() && currentSelection.row >= firstRow && currentSelection.row <= lastRow)
+    {
+        int top = rowViewportPosition(currentSelection.row);
+        painter->fillRect(QRect(QPoint(origin + currentSelection.start, top),
+                               QPoint(origin + currentSelection.end, top + rowHeight(currentSelection.row) - 1)),
+                         QBrush(QColor(0, 255, 0, 64)));
+    }
+}
+
+// 帧的显示宽度保持在原列宽和两倍原列宽之间
+int RangeTable::FilmstripLevel() const
+{
+    int level = 0;
+    while (level < FilmstripAtlas::MaxLevel && m_columnWidth > 0 && (m_columnWidth << (level + 1)) <= m_zoomedColumnWidth)
+    {
+        ++level;
+    }
+    return level;
+}
+
+// 同一页中的帧合成一次drawPixmapFragments，每个可见行通常只有一两页
+void RangeTable::PaintFilmstrip(QPainter *painter, const QRect &dirtyRect)
+{
+    VMERGE_TRACE_SCOPE("paint.filmstrip");
+    // 缩到列宽只有几个像素时缩略图已看不清，不再绘制
+    if (!model() || m_zoomedColumnWidth < 8 || m_rowHeight <= 0 || model()->rowCount() == 0 || model()->columnCount() == 0)
+    {
+        return;
+    }
+
+    int level = FilmstripLevel();
+    qint64 frameCount = static_cast<qint64>(model()->columnCount()) << level;
+    double frameWidth = static_cast<double>(m_zoomedColumnWidth) / (1 << level);
+    int origin = columnViewportPosition(0);
+    int firstRow = qBound(0, (dirtyRect.top() - rowViewportPosition(0)) / m_rowHeight, model()->rowCount()-1);
+    int lastRow = qBound(0, (dirtyRect.bottom() - rowViewportPosition(0)) / m_rowHeight, model()->rowCount()-1);
+    qint64 firstFrame = qBound(Q_INT64_C(0), static_cast<qint64>(std::floor((dirtyRect.left() - origin) / frameWidth)), frameCount - 1);
+    qint64 lastFrame = qBound(Q_INT64_C(0), static_cast<qint64>(std::floor((dirtyRect.right() - origin) / frameWidth)), frameCount - 1);
+
+    QVector<QPainter::PixmapFragment> fragments;
+    QPixmap batchPage;
+    QPixmap page;
+    QRect source;
+    for (int row = firstRow; row <= lastRow; ++row)
+    {
+        double centerY = rowViewportPosition(row) + (m_rowHeight - 1) / 2.0;
+        for (qint64 frame = firstFrame; frame <= lastFrame; ++frame)
+        {
+            if (!m_atlasPtr->Locate(row, level, frame, &page, &source))
+            {
+                continue;
+            }
+            if (!fragments.isEmpty() && page.cacheKey() != batchPage.cacheKey())
+            {
+                painter->drawPixmapFragments(fragments.constData(), fragments.size(), batchPage);
+                fragments.clear();
+            }
+            batchPage = page;
+            fragments.push_back(QPainter::PixmapFragment::create(QPointF(origin + (frame + 0.5) * frameWidth, centerY), source,
+                                                                 frameWidth / source.width(), static_cast<double>(m_rowHeight - 1) / source.height()));
+        }
+    }
+    if (!fragments.isEmpty())
+    {
+        painter->drawPixmapFragments(fragments.constData(), fragments.size(), batchPage);
+    }
+}
+
+void RangeTable::PaintActivity(QPainter *painter, const QRect &dirtyRect)
+{
+    VMERGE_TRACE_SCOPE("paint.activity");
+    if (m_activityPtr->IsEmpty() || !model() || !m_timeScale.IsValid() || m_rowHeight <= 0 || model()->rowCount() == 0)
+    {
+        return;
+    }
+
+    int origin = columnViewportPosition(0);
+    int firstRow = qBound(0, (dirtyRect.top() - rowViewportPosition(0)) / m_rowHeight, model()->rowCount()-1);
+    int lastRow = qBound(0, (dirtyRect.bottom() - rowViewportPosition(0)) / m_rowHeight, model()->rowCount()-1);
+    for (int row = firstRow; row <= lastRow; ++row)
+    {
+        QRect rowRect(dirtyRect.left(), rowViewportPosition(row), dirtyRect.width(), rowHeight(row));
+        m_activityPtr->Paint(painter, row, rowRect, m_timeScale, origin, dirtyRect.left() - origin, dirtyRect.right() - origin);
+    }
+}
+
+void RangeTable::resizeEvent(QResizeEvent *event)
+{
+    QTableView::resizeEvent(event);
+    m_cursor.SetSize(m_columnWidth, m_rowTexts.size() * m_rowHeight, fontMetrics().height());
+    UpdateTimeScale();
+    RequestVisibleCells();
+}
+
+void RangeTable::mousePressEvent(QMouseEvent *event)
+{
+    QTableView::mousePressEvent(event);
+    int x = event->x() - columnViewportPosition(0);
+    if (x >= 0 && x < m_zoomedColumnWidth*m_headTexts.size())
+    {
+        int row = indexAt(event->pos()).row();
+        m_newSelection.row = row;
+        m_newSelection.start = x;
+        m_grabAnchor = x;
+        m_grabNow = true;
+    }
+}
+
+void RangeTable::mouseMoveEvent(QMouseEvent *event)
+{
+    QTableView::mouseMoveEvent(event);
+    if (m_grabNow)
+    {
+        int x = event->x() - columnViewportPosition(0);
+        if (x >= 0 && x < m_zoomedColumnWidth*m_headTexts.size())
+        {
+            UpdateGrab(x);
+        }
+    }
+    m_pendingCursorX = event->x();
+    if (!m_cursorTimer.isActive())
+    {
+        QScreen* screen = windowHandle() ? windowHandle()->screen() : QGuiApplication::primaryScreen();
+        qreal refreshRate = screen ? screen->refreshRate() : 60;
+        m_cursorTimer.start(qMax(1, qRound(1000 / qMax(refreshRate, qreal(1)))));
+    }
+}
+
+// 拖动中的选择总是保存为start <= end；吸附后两端都可能移动，只重绘两端各自变化的部分
+void RangeTable::UpdateGrab(int x)
+{
+    int low = qMin(m_grabAnchor, x);
+    int high = qMax(m_grabAnchor, x);
+    // 像素范围换算成刻度，终点边界取下一个像素的起点
+    qint64 startTick = m_timeScale.ToTick(low);
+    qint64 endEdge = m_timeScale.ToTick(high + 1);
+    if (m_snapping)
+    {
+        qint64 tolerance = (static_cast<qint64>(m_snapPixels) * m_timeScale.ticksPerPixel) >> TimeScale::FractionBits;
+        qint64 snappedStart = m_snapIndex.Snap(m_engine.Selections(), m_newSelection.row, startTick, tolerance);
+        qint64 snappedEnd = m_snapIndex.Snap(m_engine.Selections(), m_newSelection.row, endEdge, tolerance);
+        // 两端吸到同一点时保持原样，不产生空选择
+        if (snappedEnd > snappedStart)
+        {
+            startTick = snappedStart;
+            endEdge = snappedEnd;
+        }
+    }
+    m_newSelectionTicks = TickRange(startTick, endEdge - 1);
+
+    RowPixelRange old = m_newSelection;
+    m_newSelection.start = m_timeScale.ToPixel(startTick);
+    m_newSelection.end = qMax(m_newSelection.start, m_timeScale.ToPixel(endEdge) - 1);
+    if (old.end == -1)
+    {
+        UpdatePixelSpan(m_newSelection.row, m_newSelection.start, m_newSelection.end);
+        return;
+    }
+    if (old.start != m_newSelection.start)
+    {
+        UpdatePixelSpan(m_newSelection.row, qMin(old.start, m_newSelection.start), qMax(old.start, m_newSelection.start));
+    }
+    if (old.end != m_newSelection.end)
+    {
+        UpdatePixelSpan(m_newSelection.row, qMin(old.end, m_newSelection.end), qMax(old.end, m_newSelection.end));
+    }
+}
+
+void RangeTable::ApplyCursorMove()
+{
+    QRegion damage = m_cursor.Damage();
+    m_cursor.MoveTo(m_pendingCursorX);
+    damage += m_cursor.Damage();
+    viewport()->update(damage);
+}
+
+void RangeTable::keyPressEvent(QKeyEvent *event)
+{
+    if (event->matches(QKeySequence::Undo))
+    {
+        Undo();
+    }
+    else if (event->matches(QKeySequence::Redo))
+    {
+        Redo();
+    }
+    else
+    {
+        QTableView::keyPressEvent(event);
+    }
+}
+
+void RangeTable::wheelEvent(QWheelEvent *event)
+{
+    // 滚轮每格（120单位）缩放1.25倍，触控板的小步进同样平滑
+    if (event->modifiers() & Qt::ControlModifier)
+    {
+        SetZoom(m_zoom * std::pow(1.25, event->angleDelta().y() / 120.0), event->position().toPoint().x());
+        event->accept();
+        return;
+    }
+    QTableView::wheelEvent(event);
+}
+
+void RangeTable::EndGrab()
+{
+    if (m_grabNow && m_newSelection.IsValid())
+    {
+        ProcessNewSelection();
+        m_newSelection.Reset();
+    }
+    m_grabNow = false;
+}
+
+void RangeTable::mouseReleaseEvent(QMouseEvent *event)
+{
+    QTableView::mouseReleaseEvent(event);
+    EndGrab();
+}
+
+void RangeTable::leaveEvent(QEvent *event)
+{
+    QTableView::leaveEvent(event);
+    EndGrab();
+}
+
+void RangeTable::ProcessNewSelection()
+{
+    VMERGE_TRACE_SCOPE("edit.select");
+    // 拖动时已保证start <= end，刻度范围也已按吸附结果算好
+    qint64 startTick = m_newSelectionTicks.begin;
+    qint64 endTick = m_newSelectionTicks.end;
+
+    // 增加选择时和其他行重叠的部分由索引除去，删除选择只影响选中行
+    SelectionDelta delta;
+    if (m_select2Add)
+    {
+        delta = m_engine.Add(m_newSelection.row, startTick, endTick);
+    }
+    else
+    {
+        delta = m_engine.Subtract(m_newSelection.row, startTick, endTick);
+    }
+
+    // 拖动高亮要擦掉，选择只重绘实际变化的部分
+    UpdatePixelSpan(m_newSelection.row, m_newSelection.start, m_newSelection.end);
+    OnSelectionChanged(delta);
+}
+
+// 所有编辑、撤销、重做和批量导入的变化都经过这里
+void RangeTable::OnSelectionChanged(const SelectionDelta &delta)
+{
+    if (delta.IsEmpty())
+    {
+        return;
+    }
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        const QVector<RowSpan>& spans = pass == 0 ? delta.added : delta.removed;
+        for (int i = 0; i < spans.size(); ++i)
+        {
+            m_pyramid.Invalidate(spans[i].row);
+        }
+    }
+    UpdateDelta(delta);
+    m_pendingDelta.Append(delta);
+    if (!m_deltaTimer.isActive())
+    {
+        m_deltaTimer.start();
+    }
+}
+
+void RangeTable::FlushSelectionChanged()
+{
+    if (!m_pendingDelta.IsEmpty())
+    {
+        emit SelectionChanged(m_pendingDelta.Take());
+    }
+}
+
+// 每个涉及的行（包括因互斥被裁剪的行）只重绘变化范围的外接矩形
+void RangeTable::UpdateDelta(const SelectionDelta &delta)
+{
+    QHash<int, RowSpan> rowExtents;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        const QVector<RowSpan>& spans = pass == 0 ? delta.added : delta.removed;
+        for (int i = 0; i < spans.size(); ++i)
+        {
+            QHash<int, RowSpan>::iterator it = rowExtents.find(spans[i].row);
+            if (it == rowExtents.end())
+            {
+                rowExtents.insert(spans[i].row, spans[i]);
+            }
+            else
+            {
+                it.value().start = qMin(it.value().start, spans[i].start);
+                it.value().end = qMax(it.value().end, spans[i].end);
+            }
+        }
+    }
+    for (QHash<int, RowSpan>::const_iterator it = rowExtents.constBegin(); it != rowExtents.constEnd(); ++it)
+    {
+        UpdateTickSpan(it.key(), it.value().start, it.value().end);
+    }
+}
+
+void RangeTable::UpdateTickSpan(int row, qint64 startTick, qint64 endTick)
+{
+    int left = m_timeScale.ToPixel(startTick);
+    int right = qMax(left, m_timeScale.ToPixel(endTick + 1) - 1);
+    UpdatePixelSpan(row, left, right);
+}
+
+// 像素范围相对于第0列起点，只更新落在视口内的部分
+void RangeTable::UpdatePixelSpan(int row, int startPixel, int endPixel)
+{
+    if (!model() || row < 0 || row >= model()->rowCount())
+    {
+        return;
+    }
+    int origin = columnViewportPosition(0);
+    int top = rowViewportPosition(row);
+    QRect rect(QPoint(origin + startPixel, top), QPoint(origin + endPixel, top + rowHeight(row) - 1));
+    rect = rect.intersected(viewport()->rect());
+    if (!rect.isEmpty())
+    {
+        viewport()->update(rect);
+    }
+}
+
+RangeTable::Cursor::Cursor()
+    : m_scale(nullptr)
+    , m_ticksPerSecond(0)
+    , m_xPos(0)
+    , m_labelWidth(0)
+    , m_height(0)
+    , m_labelHeight(0)
+    , m_labelSeconds(-1)
+{
+
+}
+
+void RangeTable::Cursor::SetLabelMap(const TimeScale* scale, int ticksPerSecond)
+{
+    m_scale = scale;
+    m_ticksPerSecond = ticksPerSecond;
+    m_labelSeconds = -1;
+}
+
+void RangeTable::Cursor::SetSize(int labelWidth, int height, int labelHeight)
+{
+    m_labelWidth = labelWidth;
+    m_height = height;
+    m_labelHeight = labelHeight;
+}
+
+void RangeTable::Cursor::MoveTo(int xPos)
+{
+    m_xPos = xPos;
+}
+
+// 指针线宽2像素，标签居中显示在指针上方
+QRegion RangeTable::Cursor::Damage() const
+{
+    QRegion damage(QRect(m_xPos, 0, 2, m_height));
+    damage += QRect(m_xPos - m_labelWidth/2, 0, m_labelWidth, m_labelHeight);
+    return damage;
+}
+
+void RangeTable::Cursor::Paint(QPainter* painter, int xOffset)
+{
+    painter->fillRect(QRect(m_xPos, 0, 2, m_height), QBrush(QColor(255, 0, 0, 100)));
+    if (m_scale && m_scale->IsValid() && m_ticksPerSecond > 0)
+    {
+        int currentSeconds = static_cast<int>(m_scale->ToTick(m_xPos - xOffset) / m_ticksPerSecond);
+        painter->drawText(QRect(m_xPos - m_labelWidth/2, 0, m_labelWidth, m_labelHeight),
+                          Qt::AlignTop|Qt::AlignHCenter, Label(currentSeconds));
+    }
+}
+
+// 标签文字只在显示的秒数变化时才重新生成
+const QString& RangeTable::Cursor::Label(int seconds)
+{
+    if (seconds != m_labelSeconds)
+    {
+        m_labelSeconds = seconds;
+        m_label = QString("%1:%2").arg(seconds/60, 2, 10, QChar('0')).arg(seconds%60, 2, 10, QChar('0'));
+    }
+    return m_label;
+}
@@ -0,0 +1,218 @@
+#ifndef RANGETABLE_H
+#define RANGETABLE_H
+
+#include <QTableView>
+#include <QTime>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QThreadPool>
+#include "selectionengine.h"
+#include "deltaaccumulator.h"
+#include "coveragepyramid.h"
+#include "snapindex.h"
+#include "thumbnailloader.h"
+#include "cellpixmapcache.h"
+#include "thumbnailprovider.h"
+#include "filmstripatlas.h"
+#include "activityoverlay.h"
+
+class QPainter;
+
+class RangeTable : public QTableView
+{
+    Q_OBJECT
+
+public:
+    enum RenderMode {
+        Render_PerCell,     // 由代理逐个单元格绘制选择
+        Render_RowStrip,    // 由视图逐行绘制选择
+    };
+
+    explicit RangeTable(QWidget* parent, int rowHeadWidth=100);
+    virtual ~RangeTable();
+
+    void SetHeader(const QStringList& headerTexts, int columnWidth, Qt::Alignment alignment=Qt::AlignLeft);
+    // 只给出列数，表头显示由时间比例自动生成的刻度和时间标签
+    void SetHeader(int columnCount, int columnWidth);
+    void SetRows(const QStringList& rowHeadTexts, int rowHeight);
+    void SetTimeBase(int ticksPerSecond);
+    void SetupLayout(int timeSpanSeconds);
+    void SetSelectionMode(bool selectToAdd);
+    // 播放头由播放器驱动，负值表示隐藏；跟随模式下视口自动滚动保持播放头可见
+    void SetPlayhead(const QTime& time);
+    void SetPlayheadTick(qint64 tick);
+    qint64 PlayheadTick() const;
+    void SetFollowPlayhead(bool follow);
+    // 拖动时选择的两端吸附到本行关键帧或任意行的选择边界，threshold为吸附距离（像素）
+    void SetSnapping(bool enabled, int thresholdPixels = 8);
+    void SetKeyframes(int row, const QVector<qint64>& ticks);
+    void SetRenderMode(RenderMode mode);
+    void ResetSelection();
+
+    // 缩放时间轴，1为SetHeader给出的列宽；anchorX为视口坐标，该处的时间保持不动，默认为视口中央
+    // Ctrl+滚轮同样缩放
+    void SetZoom(double zoom, int anchorX = -1);
+    double Zoom() const;
+
+    SelectionDelta ApplySelections(const QVector<RowTickRange>& ranges, SelectionIndex::ConflictPolicy policy);
+    SelectionDelta ApplySelections(const QVector<RowTimeRange>& ranges, SelectionIndex::ConflictPolicy policy);
+    // 按集合读写一行的选择，例如行间求交、取补后写回
+    RangeSet RowSet(int row) const;
+    SelectionDelta ApplyRowSet(int row, const RangeSet& set,
+                               SelectionIndex::ConflictPolicy policy = SelectionIndex::Conflict_KeepExisting);
+
+    void Undo();
+    void Redo();
+    bool CanUndo() const;
+    bool CanRedo() const;
+    void SetHistoryBudget(qint64 bytes);
+
+    // 保存快照后清空已打开的日志；打开工程时先读快照，再重放日志并继续向它追加
+    bool SaveProject(const QString& path);
+    bool LoadProject(const QString& path, const QString& journalPath = QString());
+    bool OpenJournal(const QString& path);
+    void CloseJournal();
+
+    void AddCellData(int row, int col, const QImage& data);
+    // 以下几种方式在后台线程解码并缩放到单元格大小，完成前显示占位
+    void AddCellData(int row, int col, const QString& path);
+    void AddCellData(int row, int col, QIODevice* device);
+    void AddCellData(int row, int col, const ThumbnailLoader::LoadFunction& loader);
+    void SetDecodeThreads(int count);
+    void SetPixmapCacheBudget(qint64 bytes);
+    void SetThumbnailProvider(const QSharedPointer<ThumbnailProvider>& provider);
+    void SetThumbnailBudget(qint64 bytes);
+    // 胶片条模式下提供者的帧按缩放层级打包成图集批量绘制，放大后每列显示多帧
+    void SetFilmstrip(bool enabled);
+    void SetFilmstripBudget(qint64 bytes);
+
+    // 每行的活动量序列（运动量、音量等），从startTick起每ticksPerSample个刻度一个采样，画在选择下面
+    // 序列在后台整理成金字塔，任意长度和缩放下绘制代价都只和可见像素数有关
+    void SetActivity(int row, const QVector<float>& samples, qint64 startTick, qint64 ticksPerSample);
+    void ClearActivity(int row);
+
+    QVector<QVector<TimeRange> > GetSelectionTimes() const;
+    QVector<RowTimeRange> GetRowTimes() const;
+    QVector<QVector<TickRange> > GetSelectionTicks() const;
+    QVector<RowTickRange> GetRowTicks() const;
+    void ForEachRowTick(const std::function<bool(const RowTickRange&)>& callback) const;
+    void ForEachRowTime(const std::function<bool(const RowTimeRange&)>& callback) const;
+    // 当前选择的只读快照，可以交给其他线程导出或统计
+    SelectionSnapshot Snapshot() const;
+    // 在后台线程生成合并计划，完成后发出RowTimesExported；导出期间可以继续编辑，结果对应调用时的选择
+    void ExportRowTimesAsync();
+
+signals:
+    // 选择变化，包括因行间互斥被裁剪的其他行；同一轮事件循环中的多次编辑合并为一次净变化
+    void SelectionChanged(const SelectionDelta& delta);
+    // 选择被整体替换（重新布局、打开工程），需要重新读取全部选择
+    void SelectionReset();
+    void ZoomChanged(double zoom);
+    // revision为导出时选择的修改计数，和Snapshot().Revision()比较可知结果是否已过期
+    void RowTimesExported(quint64 revision, const QVector<RowTimeRange>& times);
+
+private:
+    virtual void paintEvent(QPaintEvent *event);
+    virtual void resizeEvent(QResizeEvent *event);
+    virtual void mousePressEvent(QMouseEvent *event);
+    virtual void mouseMoveEvent(QMouseEvent *event);
+    virtual void mouseReleaseEvent(QMouseEvent *event);
+    virtual void leaveEvent(QEvent *event);
+    virtual void keyPressEvent(QKeyEvent *event);
+    virtual void wheelEvent(QWheelEvent *event);
+    virtual void scrollContentsBy(int dx, int dy);
+    bool StripSelections() const;
+    void UpdateSelectionPainter();
+    void ApplyLayout(int timeSpanSeconds);
+    void ProcessNewSelection();
+    void EndGrab();
+    void UpdateGrab(int x);
+    QRect PlayheadDamage() const;
+    void UpdateTimeScale();
+    void ApplyColumnWidth(int width);
+    bool SetCellPending(int row, int col);
+    void RequestVisibleCells();
+    void RequestCells(const QRect& rect);
+    void PaintSelectionStrips(QPainter* painter, const QRect& dirtyRect);
+    int FilmstripLevel() const;
+    void PaintFilmstrip(QPainter* painter, const QRect& dirtyRect);
+    void PaintActivity(QPainter* painter, const QRect& dirtyRect);
+    void OnSelectionChanged(const SelectionDelta& delta);
+    void FlushSelectionChanged();
+    void UpdateDelta(const SelectionDelta& delta);
+    void UpdateTickSpan(int row, qint64 startTick, qint64 endTick);
+    void UpdatePixelSpan(int row, int startPixel, int endPixel);
+    void ApplyCursorMove();
+
+private:
+    SelectionEngine m_engine;
+    QThreadPool m_exportPool;
+    DeltaAccumulator m_pendingDelta;
+    QTimer m_deltaTimer;
+    RowPixelRange m_newSelection;
+    TickRange m_newSelectionTicks;
+    int m_grabAnchor;
+    SnapIndex m_snapIndex;
+    bool m_snapping;
+    int m_snapPixels;
+    qint64 m_playheadTick;
+    bool m_followPlayhead;
+    bool m_ruler;
+
+    int m_rowHeadWidth;
+    int m_columnWidth;
+    int m_rowHeight;
+    qint64 m_timeSpanTicks;
+    TimeScale m_timeScale;
+    double m_zoom;
+    int m_zoomedColumnWidth;
+    CoveragePyramid m_pyramid;
+    CellPixmapCache m_pixmapCache;
+
+    QStringList m_headTexts;
+    QStringList m_rowTexts;
+
+    RenderMode m_renderMode;
+    bool m_select2Add;
+    bool m_grabNow;
+
+    // 时间轴指针，直接画在视口上，移动时只重绘新旧位置的指针线和标签
+    class Cursor
+    {
+    public:
+        Cursor();
+
+        void SetLabelMap(const TimeScale* scale, int ticksPerSecond);
+        void SetSize(int labelWidth, int height, int labelHeight);
+        void MoveTo(int xPos);
+        QRegion Damage() const;
+        void Paint(QPainter* painter, int xOffset);
+
+    private:
+        const QString& Label(int seconds);
+
+    private:
+        const TimeScale* m_scale;
+        int m_ticksPerSecond;
+        int m_xPos;
+        int m_labelWidth;
+        int m_height;
+        int m_labelHeight;
+        int m_labelSeconds;
+        QString m_label;
+    };
+    Cursor m_cursor;
+    QTimer m_cursorTimer;
+    int m_pendingCursorX;
+    ThumbnailLoader* m_loaderPtr;
+    QSharedPointer<ThumbnailProvider> m_providerPtr;
+    qint64 m_thumbnailBudget;
+    FilmstripAtlas* m_atlasPtr;
+    bool m_filmstrip;
+    ActivityOverlay* m_activityPtr;
+    bool m_stripSelections;         // 选择由视图逐行绘制，而不是由代理逐格绘制
+    QPoint m_scrollDirection;
+
+};
+
+#endif // RANGETABLE_H
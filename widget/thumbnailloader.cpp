@@ -0,0 +1,125 @@
+#include "thumbnailloader.h"
+#include "tracer.h"
+
+#include <QRunnable>
+#include <QImageReader>
+#include <QBuffer>
+#include <QIODevice>
+#include <QThread>
+
+class ThumbnailDecodeTask : public QRunnable
+{
+public:
+    explicit ThumbnailDecodeTask(ThumbnailLoader* owner, int row, int col, int generation, const QSize& size, const ThumbnailLoader::LoadFunction& loader)
+        : m_owner(owner)
+        , m_row(row)
+        , m_col(col)
+        , m_generation(generation)
+        , m_size(size)
+        , m_loader(loader)
+    {}
+    virtual ~ThumbnailDecodeTask() {}
+
+private:
+    virtual void run()
+    {
+        VMERGE_TRACE_SCOPE("thumbnail.decode");
+        QImage image = m_loader(m_size);
+        // 加载函数不一定按目标尺寸返回，统一在工作线程中缩放好
+        if (!image.isNull() && m_size.isValid() && image.size() != m_size)
+        {
+            image = image.scaled(m_size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+        QMetaObject::invokeMethod(m_owner, "OnDecoded", Qt::QueuedConnection,
+                                  Q_ARG(int, m_row), Q_ARG(int, m_col), Q_ARG(int, m_generation), Q_ARG(QImage, image));
+    }
+
+private:
+    ThumbnailLoader* m_owner;
+    int m_row;
+    int m_col;
+    int m_generation;
+    QSize m_size;
+    ThumbnailLoader::LoadFunction m_loader;
+};
+
+// 图片格式支持时直接按目标尺寸解码，比先解码原图再缩放快得多
+static QImage ReadScaled(QImageReader& reader, const QSize& size)
+{
+    if (size.isValid())
+    {
+        reader.setScaledSize(size);
+    }
+    return reader.read();
+}
+
+ThumbnailLoader::ThumbnailLoader(QObject* parent)
+    : QObject(parent)
+    , m_generation(0)
+{
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+}
+
+ThumbnailLoader::~ThumbnailLoader()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void ThumbnailLoader::SetMaxThreads(int count)
+{
+    m_pool.setMaxThreadCount(qMax(1, count));
+}
+
+void ThumbnailLoader::SetTargetSize(const QSize& size)
+{
+    m_targetSize = size;
+}
+
+void ThumbnailLoader::Load(int row, int col, const QString& path)
+{
+    Load(row, col, [path](const QSize& size) -> QImage {
+        QImageReader reader(path);
+        return ReadScaled(reader, size);
+    });
+}
+
+// 设备不一定能跨线程使用，先在调用线程中读出数据，解码放到工作线程
+void ThumbnailLoader::Load(int row, int col, QIODevice* device)
+{
+    if (!device)
+    {
+        return;
+    }
+    QByteArray bytes = device->readAll();
+    Load(row, col, [bytes](const QSize& size) -> QImage {
+        QByteArray data = bytes;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer);
+        return ReadScaled(reader, size);
+    });
+}
+
+void ThumbnailLoader::Load(int row, int col, const LoadFunction& loader)
+{
+    if (loader)
+    {
+        m_pool.start(new ThumbnailDecodeTask(this, row, col, m_generation, m_targetSize, loader));
+    }
+}
+
+void ThumbnailLoader::Cancel()
+{
+    ++m_generation;
+    m_pool.clear();
+}
+
+void ThumbnailLoader::OnDecoded(int row, int col, int generation, const QImage& image)
+{
+    // Cancel之后才完成的结果已经过期
+    if (generation == m_generation)
+    {
+        emit Loaded(row, col, image);
+    }
+}
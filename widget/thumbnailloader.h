@@ -0,0 +1,45 @@
+#ifndef THUMBNAILLOADER_H
+#define THUMBNAILLOADER_H
+
+#include <QObject>
+#include <QImage>
+#include <QThreadPool>
+#include <functional>
+
+class QIODevice;
+
+// 在线程池中解码缩略图并缩放到单元格大小，结果逐个通过Loaded信号回到GUI线程
+class ThumbnailLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 自定义加载函数，参数为目标尺寸，在工作线程中调用
+    typedef std::function<QImage(const QSize&)> LoadFunction;
+
+    explicit ThumbnailLoader(QObject* parent);
+    virtual ~ThumbnailLoader();
+
+    void SetMaxThreads(int count);
+    void SetTargetSize(const QSize& size);
+
+    void Load(int row, int col, const QString& path);
+    void Load(int row, int col, QIODevice* device);
+    void Load(int row, int col, const LoadFunction& loader);
+
+    // 丢弃所有排队中和正在解码的结果
+    void Cancel();
+
+signals:
+    void Loaded(int row, int col, const QImage& image);
+
+private slots:
+    void OnDecoded(int row, int col, int generation, const QImage& image);
+
+private:
+    QThreadPool m_pool;
+    QSize m_targetSize;
+    int m_generation;   // 只在GUI线程中访问
+};
+
+#endif // THUMBNAILLOADER_H
@@ -0,0 +1,27 @@
+#ifndef THUMBNAILPROVIDER_H
+#define THUMBNAILPROVIDER_H
+
+#include <QImage>
+
+// 按需提供单元格缩略图
+// RangeTable只为可见区域及滚动方向上的下一屏请求缩略图，超出内存预算的会被淘汰，之后需要时再次请求。
+// Thumbnail和Frame在解码线程池中调用，实现需要是线程安全的
+class ThumbnailProvider
+{
+public:
+    virtual ~ThumbnailProvider() {}
+
+    virtual QImage Thumbnail(int row, int col, const QSize& size) = 0;
+
+    // 胶片条模式下取row行tick时刻的帧，放大时每列会请求多帧
+    // 默认不提供，此时只在每列一帧的层级上用Thumbnail代替
+    virtual QImage Frame(int row, qint64 tick, const QSize& size)
+    {
+        Q_UNUSED(row);
+        Q_UNUSED(tick);
+        Q_UNUSED(size);
+        return QImage();
+    }
+};
+
+#endif // THUMBNAILPROVIDER_H
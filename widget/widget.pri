@@ -0,0 +1,13 @@
+# 使用RangeTable控件的工程包含此文件，静态链接时控件库要排在引擎库之前
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+VMWIDGET_DIR = $$shadowed($$PWD)
+win32:CONFIG(release, debug|release): VMWIDGET_DIR = $$VMWIDGET_DIR/release
+else:win32:CONFIG(debug, debug|release): VMWIDGET_DIR = $$VMWIDGET_DIR/debug
+
+LIBS += -L$$VMWIDGET_DIR -lvmwidget
+win32-msvc*: PRE_TARGETDEPS += $$VMWIDGET_DIR/vmwidget.lib
+else: PRE_TARGETDEPS += $$VMWIDGET_DIR/libvmwidget.a
+
+include(../engine/engine.pri)
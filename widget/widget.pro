@@ -0,0 +1,34 @@
+#-------------------------------------------------
+#
+# RangeTable控件，建立在选择引擎之上
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = vmwidget
+TEMPLATE = lib
+CONFIG += staticlib c++11
+
+DEFINES += QT_DEPRECATED_WARNINGS
+vmerge_trace: DEFINES += VMERGE_TRACE
+
+INCLUDEPATH += ../engine
+DEPENDPATH += ../engine
+
+SOURCES += \
+        rangetable.cpp \
+        thumbnailloader.cpp \
+        cellpixmapcache.cpp \
+        filmstripatlas.cpp \
+        activityoverlay.cpp
+
+HEADERS += \
+        rangetable.h \
+        thumbnailloader.h \
+        cellpixmapcache.h \
+        filmstripatlas.h \
+        activityoverlay.h \
+        thumbnailprovider.h